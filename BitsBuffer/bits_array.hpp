@@ -3,25 +3,24 @@
 #define BITS_ARRAY_HPP
 
 #include "bits_utils.hpp"
+#include "bits_stats.hpp"
 
 #include <cstdint>
 #include <type_traits>
 #include <stdexcept>
 #include <iterator>
+#include <algorithm>
+#include <bit>
 #include <cassert>
 
 
+template<class> struct bits_words_access;
+
+BITS_STATS_NAMESPACE_BEGIN
+
 template<typename T>
 using allowed_for_bits_container_type = std::enable_if_t<std::is_unsigned_v<T>>;
 
-template<typename InputIt>
-using has_iterator_type = std::enable_if_t<
-	std::is_same_v<
-	typename std::iterator_traits<InputIt>::iterator_category,
-	typename std::iterator_traits<InputIt>::iterator_category
-	>
->;
-
 template<typename T, typename = allowed_for_bits_container_type<T>>
 class bits_array {
 	class reference_impl;
@@ -35,6 +34,8 @@ class bits_array {
 	friend class iterator_impl;
 	friend class const_iterator_impl;
 
+	template<class> friend struct ::bits_words_access;
+
 public:
 	using bits_container_type = T;
 	using value_type = bool;
@@ -54,19 +55,19 @@ public:
 	static constexpr auto max_size = 8 * sizeof(T);
 
 	explicit bits_array() = default;
-	explicit bits_array(size_type sz) : size_{ sz } { check_overflow(sz); }
-	explicit bits_array(size_type sz, bool val) : size_{ sz }
+	explicit constexpr bits_array(size_type sz) : size_{ sz } { check_overflow(sz); }
+	explicit constexpr bits_array(size_type sz, bool val) : size_{ sz }
 	{
 		check_overflow(sz);
 		if (!val) return;
 
-		bits_ |= (~(0 << sz)) << (max_size - sz);
+		bits_ = high_bits_mask<T>(sz);
 	}
 	
 	template<class It, typename = has_iterator_type<It>>
-	explicit bits_array(It first, It last) { std::copy(first, last, std::back_inserter(*this)); }
+	explicit constexpr bits_array(It first, It last) { std::copy(first, last, std::back_inserter(*this)); }
 
-	constexpr reference operator[](std::size_t index) { return reference{ bits_, index }; }
+	constexpr reference operator[](std::size_t index) { return reference{ bits_, bit_mask<T>(index) }; }
 	constexpr bool operator[](std::size_t index) const { return get_bit(bits_, index); }
 	constexpr reference at(std::size_t index) { check_index(index); return (*this)[index]; }
 	constexpr bool at(std::size_t index) const { check_index(index); return (*this)[index]; }
@@ -86,11 +87,25 @@ public:
 		check_overflow(new_size);
 
 		const auto index = it - cbegin();
+		BITS_STATS_RECORD(insert, size_ - index);
 		bits_ = insert_bits(bits_, index, count, value);
 		size_ = new_size;
 		return iterator{ *this, index };
 	}
 	constexpr iterator insert(const_iterator it, bool value) { return insert(it, 1, value); }
+	// insert with position known at compile time
+	template<size_type Index, size_type Count = 1>
+	constexpr iterator insert(bool value)
+	{
+		static_assert(Index + Count <= max_size, "inserted bits are out of range");
+		if (Index > size_) { BITS_STATS_RECORD(failed_check, 0); throw std::out_of_range{ "index is out of range" }; }
+		check_overflow(size_ + Count);
+
+		BITS_STATS_RECORD(insert, size_ - Index);
+		bits_ = insert_bits<Index, Count>(bits_, value);
+		size_ += Count;
+		return iterator{ *this, Index };
+	}
 	template<typename InputIt, typename = has_iterator_type<InputIt>>
 	constexpr iterator insert(const_iterator it, InputIt first, InputIt last)
 	{
@@ -115,19 +130,34 @@ public:
 		const auto indexLast = last - cbegin();
 		const auto count = indexLast - indexFirst;
 
+		BITS_STATS_RECORD(erase, size_ - indexLast);
 		bits_ = erase_bits(bits_, indexFirst, count);
 		size_ -= count;
 		return iterator{ *this, indexFirst };
 	}
 	constexpr iterator erase(const_iterator it)
 	{
-		if (it < cbegin() || it >= cend()) throw std::out_of_range{ "iterator is out of range" };
+		if (it < cbegin() || it >= cend()) { BITS_STATS_RECORD(failed_check, 0); throw std::out_of_range{ "iterator is out of range" }; }
 		const auto index = it - cbegin();
+		BITS_STATS_RECORD(erase, size_ - index - 1);
 		bits_ = erase_bits(bits_, index, 1);
 		--size_;
 		return iterator{ *this, index };
 	}
 
+	// erase with position known at compile time
+	template<size_type Index, size_type Count = 1>
+	constexpr iterator erase()
+	{
+		static_assert(Index + Count <= max_size, "erased bits are out of range");
+		if (Index + Count > size_) { BITS_STATS_RECORD(failed_check, 0); throw std::out_of_range{ "invalid iterators range" }; }
+
+		BITS_STATS_RECORD(erase, size_ - Index - Count);
+		bits_ = erase_bits<Index, Count>(bits_);
+		size_ -= Count;
+		return iterator{ *this, Index };
+	}
+
 	constexpr void push_back(bool value) { insert(cend(), 1, value); }
 	constexpr void pop_back() { erase(cend() - 1); }
 
@@ -136,6 +166,7 @@ public:
 		if (size_ == count) return;
 		check_overflow(count);
 
+		BITS_STATS_RECORD(resize, 0);
 		bits_ = (size_ > count) 
 			? erase_bits(bits_, count, size_ - count) 
 			: insert_bits(bits_, size_, count - size_, value);
@@ -147,6 +178,11 @@ public:
 	constexpr size_type size() const { return size_; }
 	constexpr void clear() { bits_ = 0; size_ = 0; }
 
+	// number of set bits among the first size() bits, one popcount
+	constexpr size_type count() const { return static_cast<size_type>(count_set_bits(static_cast<T>(bits_ & high_bits_mask<T>(size_)))); }
+	// inverts all bits at once
+	constexpr void flip() { bits_ ^= high_bits_mask<T>(size_); }
+
 	constexpr iterator begin() { return iterator{ *this, 0 }; }
 	constexpr iterator end() { return iterator{ *this, size_ }; }
 
@@ -159,17 +195,23 @@ public:
 private: // reference implementation
 	class reference_impl {
 		friend class bits_array<T>;
+		friend class pointer_impl;
 		friend class iterator_impl;
 	private:
-		explicit constexpr reference_impl(bits_container_type& bits_cont, size_type index)
-			: bits_cont_{ &bits_cont }, index_{ index } {}
+		explicit constexpr reference_impl(bits_container_type& bits_cont, bits_container_type mask)
+			: bits_cont_{ &bits_cont }, mask_{ mask } {}
 	public:
-		constexpr reference_impl& operator=(bool value)
+		constexpr reference_impl(const reference_impl&) = default;
+
+		// const as proxy writes through const references are required by std::indirectly_writable
+		constexpr const reference_impl& operator=(bool value) const
 		{
-			*bits_cont_ = set_bit(*bits_cont_, index_, value);
+			BITS_STATS_RECORD(proxy_write, 0);
+			*bits_cont_ = value ? (*bits_cont_ | mask_) : (*bits_cont_ & static_cast<bits_container_type>(~mask_));
 			return *this;
 		}
-		constexpr operator bool() { assert(bits_cont_ != nullptr); return get_bit(*bits_cont_, index_); }
+		constexpr reference_impl& operator=(const reference_impl& other) { *this = bool(other); return *this; }
+		constexpr operator bool() const { assert(bits_cont_ != nullptr); return (*bits_cont_ & mask_) != 0; }
 		constexpr friend void swap(reference_impl left, reference_impl right)
 		{
 			const bool tmp = bool(left);
@@ -179,7 +221,7 @@ private: // reference implementation
 
 	private:
 		bits_container_type* bits_cont_ = nullptr;
-		size_type index_ = 0;
+		bits_container_type mask_ = 0;
 	};
 
 private: // pointers implementation
@@ -187,12 +229,12 @@ private: // pointers implementation
 		friend class bits_array<T>;
 		friend class iterator_impl;
 	private:
-		explicit constexpr pointer_impl(bits_container_type& bits_cont, size_type index)
-			: bits_cont_{ &bits_cont }, index_{ index } {}
+		explicit constexpr pointer_impl(bits_container_type& bits_cont, bits_container_type mask)
+			: bits_cont_{ &bits_cont }, mask_{ mask } {}
 
 	public:
-		constexpr reference_impl operator*() { return reference_impl{ *bits_cont_, index_ }; }
-		constexpr reference_impl operator->() { return reference_impl{ *bits_cont_, index_ }; }
+		constexpr reference_impl operator*() const { return reference_impl{ *bits_cont_, mask_ }; }
+		constexpr reference_impl operator->() const { return reference_impl{ *bits_cont_, mask_ }; }
 
 		constexpr operator bool() const { return bits_cont_ != nullptr; }
 
@@ -201,19 +243,19 @@ private: // pointers implementation
 
 	private:
 		bits_container_type* bits_cont_ = nullptr;
-		size_type index_ = 0;
+		bits_container_type mask_ = 0;
 	};
 
 	class const_pointer_impl {
 		friend class bits_array<T>;
 		friend class const_iterator_impl;
 	private:
-		explicit constexpr const_pointer_impl(const bits_container_type& bits_cont, size_type index)
-			: bits_cont_{ &bits_cont }, index_{ index } {}
+		explicit constexpr const_pointer_impl(const bits_container_type& bits_cont, bits_container_type mask)
+			: bits_cont_{ &bits_cont }, mask_{ mask } {}
 
 	public:
-		constexpr bool operator*() { return get_bit(*bits_cont_, index_); }
-		constexpr bool operator->() { return get_bit(*bits_cont_, index_); }
+		constexpr bool operator*() const { return (*bits_cont_ & mask_) != 0; }
+		constexpr bool operator->() const { return (*bits_cont_ & mask_) != 0; }
 
 		constexpr operator bool() const { return bits_cont_ != nullptr; }
 
@@ -222,127 +264,147 @@ private: // pointers implementation
 
 	private:
 		const bits_container_type* bits_cont_ = nullptr;
-		size_type index_ = 0;
+		bits_container_type mask_ = 0;
 	};
 
 private: // iterators
-	class iterator_impl : public std::iterator<std::random_access_iterator_tag, bool, int, pointer_impl, reference_impl> {
+	// mask of the bit at index, zero for the past the end position of a full array,
+	// positions outside [0, max_size] have no mask, so they are rejected before becoming one
+	static constexpr bits_container_type mask_for(difference_type index)
+	{
+		if (index < 0 || static_cast<std::size_t>(index) > max_size) { BITS_STATS_RECORD(failed_check, 0); throw std::out_of_range{ "iterator is out of range" }; }
+		return (static_cast<std::size_t>(index) < max_size) ? bit_mask<T>(static_cast<std::size_t>(index)) : T{ 0 };
+	}
+
+	// mask of the previous position, stepping before the first bit is rejected like in mask_for
+	static constexpr bits_container_type previous_mask(bits_container_type mask)
+	{
+		if (mask == bit_mask<T>(0)) { BITS_STATS_RECORD(failed_check, 0); throw std::out_of_range{ "iterator is out of range" }; }
+		return (mask == 0) ? T{ 1 } : static_cast<T>(mask << 1);
+	}
+
+	// position of the bit selected by mask, max_size for the past the end position
+	static constexpr difference_type position_of(bits_container_type mask) { return std::countl_zero(mask); }
+
+	// iterators keep pointer to the word and mask of the current bit, the mask is the only state
+	// changed by stepping and comparing, bits go from the most significant one so the mask decreases
+	class iterator_impl {
 		friend class bits_array<T>;
 		friend class const_iterator_impl;
 
-		explicit constexpr iterator_impl(bits_array& context, int index)
-			: context_{ &context }, index_{ index } {}
+		explicit constexpr iterator_impl(bits_array& context, difference_type index)
+			: bits_cont_{ &context.bits_ }, mask_{ mask_for(index) } {}
 
 	public:
-		explicit constexpr iterator_impl() = default;
+		using iterator_concept = std::random_access_iterator_tag;
+		using iterator_category = std::random_access_iterator_tag;
+		using value_type = bool;
+		using difference_type = bits_array::difference_type;
+		using pointer = pointer_impl;
+		using reference = reference_impl;
 
-		constexpr iterator_impl& operator++() { ++index_; return *this; }
+		constexpr iterator_impl() = default;
+
+		constexpr iterator_impl& operator++() { mask_ >>= 1; return *this; }
 		constexpr iterator_impl operator++(int) { auto result = *this; ++(*this); return result; }
 
-		constexpr iterator_impl& operator--() { --index_; return *this; }
+		constexpr iterator_impl& operator--() { mask_ = previous_mask(mask_); return *this; }
 		constexpr iterator_impl operator--(int) { auto result = *this; --(*this); return result; }
 
-		constexpr iterator_impl& operator+=(difference_type shift) { index_ += shift; return *this; }
+		constexpr iterator_impl& operator+=(difference_type shift) { mask_ = mask_for(position_of(mask_) + shift); return *this; }
 		constexpr iterator_impl operator+(difference_type shift) const { auto result = *this; result += shift; return result; }
+		friend constexpr iterator_impl operator+(difference_type shift, iterator_impl it) { return it + shift; }
 
-		constexpr iterator_impl& operator-=(difference_type shift) { index_ -= shift; return *this; }
+		constexpr iterator_impl& operator-=(difference_type shift) { return *this += -shift; }
 		constexpr iterator_impl operator-(difference_type shift) const { auto result = *this; result -= shift; return result; }
 
-		constexpr difference_type operator-(iterator_impl other) const { return index_ - other.index_; }
+		constexpr difference_type operator-(iterator_impl other) const { return position_of(mask_) - position_of(other.mask_); }
 
 		constexpr reference_impl operator*() const
 		{
-			assert(context_ != nullptr);
-			assert((index_ >= 0 && index_ < context_->size_));
-			return reference_impl{ context_->bits_, static_cast<size_type>(index_) };
+			assert(bits_cont_ != nullptr);
+			return reference_impl{ *bits_cont_, mask_ };
 		}
-		constexpr pointer_impl operator->() const { return pointer_impl{ context_->bits_, index_ }; }
+		constexpr pointer_impl operator->() const { return pointer_impl{ *bits_cont_, mask_ }; }
 		constexpr reference_impl operator[](difference_type n) const { return *(*this + n); }
 
-		constexpr bool operator<(iterator_impl other) { return (*this - other) < 0; }
-		constexpr bool operator>(iterator_impl other) { return (*this - other) > 0; }
+		constexpr bool operator<(iterator_impl other) const { return mask_ > other.mask_; }
+		constexpr bool operator>(iterator_impl other) const { return mask_ < other.mask_; }
 
-		constexpr bool operator==(iterator_impl other) { return (*this - other) == 0; }
-		constexpr bool operator!=(iterator_impl other) { return !(*this == other); }
+		constexpr bool operator==(iterator_impl other) const { return mask_ == other.mask_; }
+		constexpr bool operator!=(iterator_impl other) const { return mask_ != other.mask_; }
 
-		constexpr bool operator<=(iterator_impl other) { return !(*this > other); }
-		constexpr bool operator>=(iterator_impl other) { return !(*this < other); }
+		constexpr bool operator<=(iterator_impl other) const { return mask_ >= other.mask_; }
+		constexpr bool operator>=(iterator_impl other) const { return mask_ <= other.mask_; }
 
 	private:
-		bits_array* context_ = nullptr;
-		difference_type index_ = 0;
+		bits_container_type* bits_cont_ = nullptr;
+		bits_container_type mask_ = 0;
 	};
 
-	class const_iterator_impl : public std::iterator<std::random_access_iterator_tag, bool, int, const_pointer_impl, bool> {
+	class const_iterator_impl {
 		friend class bits_array<T>;
 
-	private:
 		explicit constexpr const_iterator_impl(const bits_array& context, difference_type index)
-			: context_{ &context }, index_{ index } {}
+			: bits_cont_{ &context.bits_ }, mask_{ mask_for(index) } {}
 
 	public:
-		explicit constexpr const_iterator_impl() = default;
-		explicit constexpr const_iterator_impl(const iterator_impl& other)
-			: context_{ other.context_ }, index_{ other.index_ } {}
-
-		constexpr const_iterator_impl& operator=(const iterator_impl& other)
-		{
-			context_ = other.context_;
-			index_ = other.index_;
-			return *this;
-		}
-
-		constexpr const_iterator_impl(const const_iterator_impl&) = default;
-		constexpr const_iterator_impl& operator=(const const_iterator_impl&) = default;
-
-		constexpr const_iterator_impl(const_iterator_impl&&) = default;
-		constexpr const_iterator_impl& operator=(const_iterator_impl&&) = default;
-
-		constexpr const_iterator_impl& operator++() { ++index_; return *this; }
+		using iterator_concept = std::random_access_iterator_tag;
+		using iterator_category = std::random_access_iterator_tag;
+		using value_type = bool;
+		using difference_type = bits_array::difference_type;
+		using pointer = const_pointer_impl;
+		using reference = bool;
+
+		constexpr const_iterator_impl() = default;
+		constexpr const_iterator_impl(const iterator_impl& other)
+			: bits_cont_{ other.bits_cont_ }, mask_{ other.mask_ } {}
+
+		constexpr const_iterator_impl& operator++() { mask_ >>= 1; return *this; }
 		constexpr const_iterator_impl operator++(int) { auto result = *this; ++(*this); return result; }
 
-		constexpr const_iterator_impl& operator--() { --index_; return *this; }
+		constexpr const_iterator_impl& operator--() { mask_ = previous_mask(mask_); return *this; }
 		constexpr const_iterator_impl operator--(int) { auto result = *this; --(*this); return result; }
 
-		constexpr const_iterator_impl& operator+=(difference_type shift) { index_ += shift; return *this; }
+		constexpr const_iterator_impl& operator+=(difference_type shift) { mask_ = mask_for(position_of(mask_) + shift); return *this; }
 		constexpr const_iterator_impl operator+(difference_type shift) const { auto result = *this; result += shift; return result; }
+		friend constexpr const_iterator_impl operator+(difference_type shift, const_iterator_impl it) { return it + shift; }
 
-		constexpr const_iterator_impl& operator-=(difference_type shift) { index_ -= shift; return *this; }
+		constexpr const_iterator_impl& operator-=(difference_type shift) { return *this += -shift; }
 		constexpr const_iterator_impl operator-(difference_type shift) const { auto result = *this; result -= shift; return result; }
 
-		constexpr difference_type operator-(const_iterator_impl other) const { return index_ - other.index_; }
+		constexpr difference_type operator-(const_iterator_impl other) const { return position_of(mask_) - position_of(other.mask_); }
 
 		constexpr bool operator*() const
 		{
-			assert(context_ != nullptr);
-			assert((index_ >= 0 && index_ < context_->size_));
-			return get_bit(context_->bits_, index_);
+			assert(bits_cont_ != nullptr);
+			return (*bits_cont_ & mask_) != 0;
 		}
-		constexpr const_pointer_impl operator->() const { return const_pointer_impl{ context_->bits_, index_ }; }
+		constexpr const_pointer_impl operator->() const { return const_pointer_impl{ *bits_cont_, mask_ }; }
 		constexpr bool operator[](difference_type n) const { return *(*this + n); }
 
-		constexpr bool operator<(const_iterator_impl other) { return (*this - other) < 0; }
-		constexpr bool operator>(const_iterator_impl other) { return (*this - other) > 0; }
+		constexpr bool operator<(const_iterator_impl other) const { return mask_ > other.mask_; }
+		constexpr bool operator>(const_iterator_impl other) const { return mask_ < other.mask_; }
 
-		constexpr bool operator==(const_iterator_impl other) { return (*this - other) == 0; }
-		constexpr bool operator!=(const_iterator_impl other) { return !(*this == other); }
+		constexpr bool operator==(const_iterator_impl other) const { return mask_ == other.mask_; }
+		constexpr bool operator!=(const_iterator_impl other) const { return mask_ != other.mask_; }
 
-		constexpr bool operator<=(const_iterator_impl other) { return !(*this > other); }
-		constexpr bool operator>=(const_iterator_impl other) { return !(*this < other); }
+		constexpr bool operator<=(const_iterator_impl other) const { return mask_ >= other.mask_; }
+		constexpr bool operator>=(const_iterator_impl other) const { return mask_ <= other.mask_; }
 
 	private:
-		const bits_array* context_ = nullptr;
-		difference_type index_ = 0;
+		const bits_container_type* bits_cont_ = nullptr;
+		bits_container_type mask_ = 0;
 	};
 
 private:
-	void check_index(size_type index) const { if (index >= size_) throw std::out_of_range{ "index is out of range" }; }
-	void check_overflow(size_type sz) const { if (sz > max_size) throw std::overflow_error{ "size is greater than maximum allowed" }; }
-	void empty_check() const { if (empty()) throw std::out_of_range{ "container is empty" }; }
-	void check_iterator(const_iterator it) const { if (it < cbegin() || it > cend()) throw std::out_of_range{ "iterator is out of range" }; }
-	void check_iterators_range(const_iterator first, const_iterator last) const
+	constexpr void check_index(std::size_t index) const { if (index >= size_) { BITS_STATS_RECORD(failed_check, 0); throw std::out_of_range{ "index is out of range" }; } }
+	constexpr void check_overflow(std::size_t sz) const { if (sz > max_size) { BITS_STATS_RECORD(failed_check, 0); throw std::overflow_error{ "size is greater than maximum allowed" }; } }
+	constexpr void empty_check() const { if (empty()) { BITS_STATS_RECORD(failed_check, 0); throw std::out_of_range{ "container is empty" }; } }
+	constexpr void check_iterator(const_iterator it) const { if (it < cbegin() || it > cend()) { BITS_STATS_RECORD(failed_check, 0); throw std::out_of_range{ "iterator is out of range" }; } }
+	constexpr void check_iterators_range(const_iterator first, const_iterator last) const
 	{
-		if (first > last || first < cbegin() || last > cend()) throw std::out_of_range{ "invalid iterators range" };
+		if (first > last || first < cbegin() || last > cend()) { BITS_STATS_RECORD(failed_check, 0); throw std::out_of_range{ "invalid iterators range" }; }
 	}
 
 private:
@@ -350,4 +412,35 @@ private:
 	bits_container_type bits_{ 0 };
 };
 
+// builds bits_array from string of '0' and '1' at compile time
+template<typename T, std::size_t N>
+consteval bits_array<T> make_bits_array(const char (&str)[N])
+{
+	static_assert(N - 1 <= 8 * sizeof(T), "string is longer than bits_array capacity");
+
+	bits_array<T> result;
+	for (std::size_t i = 0; i + 1 < N; ++i) {
+		if (str[i] != '0' && str[i] != '1') throw std::invalid_argument{ "only '0' and '1' are allowed" };
+		result.push_back(str[i] == '1');
+	}
+	return result;
+}
+
+template<std::size_t N>
+struct bits_literal {
+	consteval bits_literal(const char (&str)[N]) { std::copy_n(str, N, chars); }
+	char chars[N]{};
+};
+
+// "1011"_bits gives bits_array with the smallest container type able to hold all bits
+template<bits_literal Str>
+consteval auto operator""_bits()
+{
+	constexpr auto count = sizeof(Str.chars) - 1;
+	static_assert(count <= 64, "bits literal is too long");
+	return make_bits_array<smallest_unsigned_type<count>>(Str.chars);
+}
+
+BITS_STATS_NAMESPACE_END
+
 #endif // !BITS_ARRAY_HPP
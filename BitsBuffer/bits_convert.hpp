@@ -0,0 +1,312 @@
+#pragma once
+#ifndef BITS_CONVERT_HPP
+#define BITS_CONVERT_HPP
+
+#include "bits_array.hpp"
+#include "static_bits_array.hpp"
+#include "bits_tree.hpp"
+
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <bitset>
+#include <utility>
+#include <algorithm>
+#include <version>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BITS_CONVERT_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef __cpp_lib_format
+#include <format>
+#endif
+
+
+enum class bit_order { msb_first, lsb_first };
+
+template<class T> struct is_bits_container : std::false_type {};
+template<class T, class E> struct is_bits_container<bits_array<T, E>> : std::true_type {};
+template<std::size_t N> struct is_bits_container<static_bits_array<N>> : std::true_type {};
+template<> struct is_bits_container<bits_tree> : std::true_type {};
+
+template<class T>
+inline constexpr bool is_bits_container_v = is_bits_container<T>::value;
+
+// Bulk access to bits as 64-bit words, first bit of the sequence is the most significant bit of words[0].
+// Generic version goes through iterators, containers which store words directly specialize it.
+template<class BitsContainer>
+struct bits_words_access {
+	static void read(const BitsContainer& cont, std::uint64_t* words)
+	{
+		std::size_t index = 0;
+		std::uint64_t word = 0;
+		for (const bool bit : cont) {
+			word = (word << 1) | bit;
+			if (++index % 64 == 0) *words++ = std::exchange(word, 0);
+		}
+		if (index % 64 != 0) *words = word << (64 - index % 64);
+	}
+
+	static void write(BitsContainer& cont, const std::uint64_t* words, std::size_t count)
+	{
+		cont.clear();
+		for (std::size_t i = 0; i < count; ++i) {
+			cont.push_back(get_bit(words[i / 64], i % 64));
+		}
+	}
+};
+
+template<class T, class E>
+struct bits_words_access<bits_array<T, E>> {
+	static constexpr auto max_size = bits_array<T, E>::max_size;
+
+	static void read(const bits_array<T, E>& cont, std::uint64_t* words)
+	{
+		if (cont.size_ != 0) words[0] = static_cast<std::uint64_t>(cont.bits_) << (64 - max_size);
+	}
+
+	static void write(bits_array<T, E>& cont, const std::uint64_t* words, std::size_t count)
+	{
+		cont.check_overflow(count);
+		cont.bits_ = (count == 0) ? T{ 0 } : static_cast<T>((words[0] & high_bits_mask<std::uint64_t>(count)) >> (64 - max_size));
+		cont.size_ = static_cast<typename bits_array<T, E>::size_type>(count);
+	}
+};
+
+template<std::size_t N>
+struct bits_words_access<static_bits_array<N>> {
+	static void read(const static_bits_array<N>& cont, std::uint64_t* words)
+	{
+		std::copy_n(cont.words_.cbegin(), (cont.size_ + 63) / 64, words);
+	}
+
+	static void write(static_bits_array<N>& cont, const std::uint64_t* words, std::size_t count)
+	{
+		cont.check_overflow(count);
+		cont.words_.fill(0);
+		std::copy_n(words, (count + 63) / 64, cont.words_.begin());
+		if (count % 64 != 0) cont.words_[count / 64] &= high_bits_mask<std::uint64_t>(count % 64);
+		cont.size_ = static_cast<typename static_bits_array<N>::size_type>(count);
+	}
+};
+
+template<>
+struct bits_words_access<bits_tree> {
+	static void read(const bits_tree& cont, std::uint64_t* words) { cont.copy_to_words(words); }
+	static void write(bits_tree& cont, const std::uint64_t* words, std::size_t count) { cont.assign_words(words, count); }
+};
+
+namespace bits_convert_detail {
+
+	inline std::uint8_t reverse_byte(std::uint8_t b)
+	{
+		b = static_cast<std::uint8_t>(((b & 0xF0) >> 4) | ((b & 0x0F) << 4));
+		b = static_cast<std::uint8_t>(((b & 0xCC) >> 2) | ((b & 0x33) << 2));
+		return static_cast<std::uint8_t>(((b & 0xAA) >> 1) | ((b & 0x55) << 1));
+	}
+
+	inline std::uint64_t parse_char(char c)
+	{
+		if (c != '0' && c != '1') throw std::invalid_argument{ "only '0' and '1' are allowed" };
+		return c == '1';
+	}
+
+#ifdef BITS_CONVERT_SSE2
+	// compares 16 chars against '1' and gathers results with movemask, first char goes to the most significant bit
+	inline std::uint64_t parse_16_chars(const char* text)
+	{
+		const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text));
+		const __m128i ones = _mm_cmpeq_epi8(chars, _mm_set1_epi8('1'));
+		const __m128i zeros = _mm_cmpeq_epi8(chars, _mm_set1_epi8('0'));
+		if (_mm_movemask_epi8(_mm_or_si128(ones, zeros)) != 0xFFFF) throw std::invalid_argument{ "only '0' and '1' are allowed" };
+
+		// movemask takes byte 0 as the least significant bit, so reverse bytes order first
+		__m128i reversed = _mm_shuffle_epi32(ones, _MM_SHUFFLE(0, 1, 2, 3));
+		reversed = _mm_shufflelo_epi16(reversed, _MM_SHUFFLE(2, 3, 0, 1));
+		reversed = _mm_shufflehi_epi16(reversed, _MM_SHUFFLE(2, 3, 0, 1));
+		reversed = _mm_or_si128(_mm_slli_epi16(reversed, 8), _mm_srli_epi16(reversed, 8));
+		return static_cast<std::uint16_t>(_mm_movemask_epi8(reversed));
+	}
+
+	// spreads 16 bits to 16 bytes and turns them into '0' and '1'
+	inline void format_16_bits(std::uint64_t bits, char* text)
+	{
+		constexpr std::uint64_t broadcast = 0x0101010101010101ull;
+		constexpr std::uint64_t selectors = 0x0102040810204080ull;
+
+		const __m128i spread = _mm_set_epi64x(static_cast<long long>((bits & 0xFF) * broadcast), static_cast<long long>(((bits >> 8) & 0xFF) * broadcast));
+		const __m128i mask = _mm_set1_epi64x(static_cast<long long>(selectors));
+		const __m128i isSet = _mm_cmpeq_epi8(_mm_and_si128(spread, mask), mask);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(text), _mm_sub_epi8(_mm_set1_epi8('0'), isSet));
+	}
+#endif // BITS_CONVERT_SSE2
+
+	// packs count chars of '0' and '1' into words
+	inline void parse_text(const char* text, std::size_t count, std::uint64_t* words)
+	{
+		const auto fullWords = count / 64;
+		for (std::size_t w = 0; w < fullWords; ++w, text += 64) {
+			std::uint64_t word = 0;
+#ifdef BITS_CONVERT_SSE2
+			for (std::size_t i = 0; i < 64; i += 16) word = (word << 16) | parse_16_chars(text + i);
+#else
+			for (std::size_t i = 0; i < 64; ++i) word = (word << 1) | parse_char(text[i]);
+#endif
+			words[w] = word;
+		}
+
+		const auto tail = count % 64;
+		if (tail == 0) return;
+
+		std::uint64_t word = 0;
+		for (std::size_t i = 0; i < tail; ++i) word = (word << 1) | parse_char(text[i]);
+		words[fullWords] = word << (64 - tail);
+	}
+
+	// writes count bits from words as '0' and '1' chars
+	inline void format_text(const std::uint64_t* words, std::size_t count, char* text)
+	{
+		const auto fullWords = count / 64;
+		for (std::size_t w = 0; w < fullWords; ++w, text += 64) {
+#ifdef BITS_CONVERT_SSE2
+			for (std::size_t i = 0; i < 4; ++i) format_16_bits(words[w] >> (48 - 16 * i), text + 16 * i);
+#else
+			for (std::size_t i = 0; i < 64; ++i) text[i] = get_bit(words[w], i) ? '1' : '0';
+#endif
+		}
+
+		for (std::size_t i = 0; i < count % 64; ++i) text[i] = get_bit(words[fullWords], i) ? '1' : '0';
+	}
+
+	template<class BitsContainer>
+	std::vector<std::uint64_t> read_words(const BitsContainer& cont)
+	{
+		std::vector<std::uint64_t> words((cont.size() + 63) / 64);
+		bits_words_access<BitsContainer>::read(cont, words.data());
+		return words;
+	}
+
+	template<class BitsContainer>
+	BitsContainer write_words(const std::vector<std::uint64_t>& words, std::size_t count)
+	{
+		BitsContainer result;
+		bits_words_access<BitsContainer>::write(result, words.data(), count);
+		return result;
+	}
+
+} // namespace bits_convert_detail
+
+
+// "0101" text
+template<class BitsContainer>
+std::string to_bits_string(const BitsContainer& cont)
+{
+	const auto words = bits_convert_detail::read_words(cont);
+	std::string result(cont.size(), '0');
+	bits_convert_detail::format_text(words.data(), result.size(), result.data());
+	return result;
+}
+
+template<class BitsContainer>
+BitsContainer from_bits_string(std::string_view text)
+{
+	std::vector<std::uint64_t> words((text.size() + 63) / 64);
+	bits_convert_detail::parse_text(text.data(), text.size(), words.data());
+	return bits_convert_detail::write_words<BitsContainer>(words, text.size());
+}
+
+// std::vector<bool>, element i is bit i of the container
+template<class BitsContainer>
+std::vector<bool> to_vector_bool(const BitsContainer& cont)
+{
+	const auto words = bits_convert_detail::read_words(cont);
+	std::vector<bool> result(cont.size());
+	for (std::size_t i = 0; i < result.size(); ++i) result[i] = get_bit(words[i / 64], i % 64);
+	return result;
+}
+
+template<class BitsContainer>
+BitsContainer from_vector_bool(const std::vector<bool>& vec)
+{
+	std::vector<std::uint64_t> words((vec.size() + 63) / 64);
+	for (std::size_t i = 0; i < vec.size(); ++i) words[i / 64] |= std::uint64_t{ vec[i] } << (63 - i % 64);
+	return bits_convert_detail::write_words<BitsContainer>(words, vec.size());
+}
+
+// std::bitset, bitset[i] is bit i of the container, so to_string() of the bitset shows it reversed
+template<std::size_t N, class BitsContainer>
+std::bitset<N> to_bitset(const BitsContainer& cont)
+{
+	if (cont.size() > N) throw std::overflow_error{ "size is greater than maximum allowed" };
+
+	const auto words = bits_convert_detail::read_words(cont);
+	std::bitset<N> result;
+	for (std::size_t i = 0; i < cont.size(); ++i) result[i] = get_bit(words[i / 64], i % 64);
+	return result;
+}
+
+template<class BitsContainer, std::size_t N>
+BitsContainer from_bitset(const std::bitset<N>& bits)
+{
+	std::vector<std::uint64_t> words((N + 63) / 64);
+	for (std::size_t i = 0; i < N; ++i) words[i / 64] |= std::uint64_t{ bits[i] } << (63 - i % 64);
+	return bits_convert_detail::write_words<BitsContainer>(words, N);
+}
+
+// packed bytes, order tells which bit of a byte holds the first of its 8 bits
+template<class BitsContainer>
+std::vector<std::uint8_t> to_bytes(const BitsContainer& cont, bit_order order = bit_order::msb_first)
+{
+	const auto words = bits_convert_detail::read_words(cont);
+	std::vector<std::uint8_t> result((cont.size() + 7) / 8);
+	for (std::size_t i = 0; i < result.size(); ++i) {
+		const auto byte = static_cast<std::uint8_t>(words[i / 8] >> (56 - 8 * (i % 8)));
+		result[i] = (order == bit_order::msb_first) ? byte : bits_convert_detail::reverse_byte(byte);
+	}
+	return result;
+}
+
+// bitsCount is a number of bits, not bytes: data holds (bitsCount + 7) / 8 packed bytes and
+// padding bits of the last byte are ignored
+template<class BitsContainer>
+BitsContainer from_bytes(const std::uint8_t* data, std::size_t bitsCount, bit_order order = bit_order::msb_first)
+{
+	std::vector<std::uint64_t> words((bitsCount + 63) / 64);
+	const auto bytesCount = (bitsCount + 7) / 8;
+	for (std::size_t i = 0; i < bytesCount; ++i) {
+		const auto byte = (order == bit_order::msb_first) ? data[i] : bits_convert_detail::reverse_byte(data[i]);
+		words[i / 8] |= std::uint64_t{ byte } << (56 - 8 * (i % 8));
+	}
+	if (bitsCount % 64 != 0) words.back() &= high_bits_mask<std::uint64_t>(bitsCount % 64);
+	return bits_convert_detail::write_words<BitsContainer>(words, bitsCount);
+}
+
+
+#ifdef __cpp_lib_format
+// std::format("{}", bits) gives the same text as to_bits_string
+template<class BitsContainer>
+	requires is_bits_container_v<BitsContainer>
+struct std::formatter<BitsContainer, char> {
+	constexpr auto parse(std::format_parse_context& ctx)
+	{
+		const auto it = ctx.begin();
+		if (it != ctx.end() && *it != '}') throw std::format_error{ "bits containers have no format options" };
+		return it;
+	}
+
+	template<class FormatContext>
+	auto format(const BitsContainer& cont, FormatContext& ctx) const
+	{
+		const auto text = to_bits_string(cont);
+		return std::copy(text.cbegin(), text.cend(), ctx.out());
+	}
+};
+#endif // __cpp_lib_format
+
+#endif // !BITS_CONVERT_HPP
@@ -0,0 +1,59 @@
+#pragma once
+#ifndef BITS_STATS_HPP
+#define BITS_STATS_HPP
+
+#include <cstdint>
+#include <type_traits>
+
+
+// Opt-in operations counters, define BITS_ENABLE_STATS before including containers to turn them on.
+// When disabled recording compiles to nothing and the stats stay zero.
+// Instrumented containers are declared in their own inline namespace, so translation units
+// built with and without stats do not share definitions and can be linked into one program.
+#ifdef BITS_ENABLE_STATS
+constexpr bool bits_stats_enabled = true;
+#define BITS_STATS_NAMESPACE_BEGIN inline namespace bits_stats_on {
+#define BITS_STATS_NAMESPACE_END }
+#else
+constexpr bool bits_stats_enabled = false;
+#define BITS_STATS_NAMESPACE_BEGIN
+#define BITS_STATS_NAMESPACE_END
+#endif
+
+struct bits_operation_stats {
+	std::uint64_t calls = 0;
+	std::uint64_t shifted_bits = 0;
+};
+
+struct bits_stats {
+	bits_operation_stats insert;
+	bits_operation_stats erase;
+	bits_operation_stats resize;
+	bits_operation_stats proxy_write;
+	bits_operation_stats failed_check;
+};
+
+// stats of the calling thread
+inline bits_stats& thread_bits_stats() noexcept
+{
+	thread_local bits_stats stats;
+	return stats;
+}
+
+inline void reset_thread_bits_stats() noexcept { thread_bits_stats() = bits_stats{}; }
+
+inline void record_bits_operation(bits_operation_stats bits_stats::* operation, std::uint64_t shifted) noexcept
+{
+	auto& stats = thread_bits_stats().*operation;
+	++stats.calls;
+	stats.shifted_bits += shifted;
+}
+
+#ifdef BITS_ENABLE_STATS
+#define BITS_STATS_RECORD(operation, shifted) \
+	do { if (!std::is_constant_evaluated()) record_bits_operation(&bits_stats::operation, (shifted)); } while (false)
+#else
+#define BITS_STATS_RECORD(operation, shifted) ((void)0)
+#endif
+
+#endif // !BITS_STATS_HPP
@@ -0,0 +1,1056 @@
+#pragma once
+#ifndef BITS_TREE_HPP
+#define BITS_TREE_HPP
+
+#include "bits_utils.hpp"
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <iterator>
+#include <cassert>
+
+
+// Dynamic bits sequence stored as a B+-tree.
+// Leaves are single cache lines of packed words, inner nodes keep size and
+// count of set bits of every child, so access, insert, erase, rank and select are O(log n).
+// Ranges are inserted and erased leaf by leaf, in O(k / 512 + log n) for k bits.
+class bits_tree {
+	class reference_impl;
+
+	class iterator_impl;
+	class const_iterator_impl;
+
+	friend class reference_impl;
+
+	template<class> friend struct bits_words_access;
+
+	using word_type = std::uint64_t;
+
+	static constexpr std::size_t word_bits = 8 * sizeof(word_type);
+	static constexpr std::size_t cache_line_size = 64;
+	static constexpr std::size_t leaf_words = cache_line_size / sizeof(word_type);
+	static constexpr std::size_t leaf_max_bits = leaf_words * word_bits;
+	static constexpr std::size_t leaf_min_bits = leaf_max_bits / 4;
+	static constexpr std::size_t inner_max_children = 16;
+	static constexpr std::size_t inner_min_children = inner_max_children / 4;
+
+public:
+	using value_type = bool;
+	using size_type = std::size_t;
+	using difference_type = std::ptrdiff_t;
+	using reference = reference_impl;
+	using const_reference = bool;
+
+	using iterator = iterator_impl;
+	using const_iterator = const_iterator_impl;
+	using reverse_iterator = std::reverse_iterator<iterator>;
+	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+public:
+	explicit bits_tree() = default;
+	explicit bits_tree(size_type sz) : bits_tree(sz, false) {}
+	explicit bits_tree(size_type sz, bool val) { splice(0, bits_source{ nullptr, 0, val }, sz); }
+
+	template<class It, typename = has_iterator_type<It>>
+	explicit bits_tree(It first, It last) { insert(cend(), first, last); }
+
+	~bits_tree() { destroy(root_, height_); }
+
+	bits_tree(const bits_tree& other)
+		: root_{ other.root_ ? clone(other.root_, other.height_) : nullptr }
+		, height_{ other.height_ }, size_{ other.size_ }, ones_{ other.ones_ } {}
+	bits_tree& operator=(const bits_tree& other)
+	{
+		if (this != &other) {
+			bits_tree tmp{ other };
+			swap(tmp);
+		}
+		return *this;
+	}
+
+	bits_tree(bits_tree&& other) noexcept
+		: root_{ std::exchange(other.root_, nullptr) }
+		, height_{ std::exchange(other.height_, 0) }
+		, size_{ std::exchange(other.size_, 0) }
+		, ones_{ std::exchange(other.ones_, 0) } {}
+	bits_tree& operator=(bits_tree&& other) noexcept
+	{
+		bits_tree tmp{ std::move(other) };
+		swap(tmp);
+		return *this;
+	}
+
+	reference operator[](size_type index) { return reference{ *this, index }; }
+	bool operator[](size_type index) const { return get(index); }
+	reference at(size_type index) { check_index(index); return (*this)[index]; }
+	bool at(size_type index) const { check_index(index); return (*this)[index]; }
+	bool empty() const { return size_ == 0; }
+
+	reference front() { empty_check(); return *(begin()); }
+	bool front() const { empty_check(); return *(cbegin()); }
+
+	reference back() { empty_check(); return *(end() - 1); }
+	bool back() const { empty_check(); return *(cend() - 1); }
+
+	// number of set bits
+	size_type count() const { return ones_; }
+
+	// number of set bits in [0, index)
+	size_type rank(size_type index) const
+	{
+		if (index > size_) throw std::out_of_range{ "index is out of range" };
+		if (index == 0) return 0;
+
+		size_type result = 0;
+		const void* current = root_;
+		for (auto height = height_; height > 0; --height) {
+			const auto& inner = as_inner(current);
+			size_type i = 0;
+			for (; i + 1 < inner.count && index >= inner.sizes[i]; ++i) {
+				index -= inner.sizes[i];
+				result += inner.ones[i];
+			}
+			current = inner.children[i];
+		}
+		return result + leaf_rank(as_leaf(current), index);
+	}
+
+	// position of the set bit with zero-based number nth
+	size_type select(size_type nth) const
+	{
+		if (nth >= ones_) throw std::out_of_range{ "there are not enough set bits" };
+
+		size_type result = 0;
+		const void* current = root_;
+		for (auto height = height_; height > 0; --height) {
+			const auto& inner = as_inner(current);
+			size_type i = 0;
+			for (; nth >= inner.ones[i]; ++i) {
+				assert(i + 1 < inner.count);
+				nth -= inner.ones[i];
+				result += inner.sizes[i];
+			}
+			current = inner.children[i];
+		}
+		return result + leaf_select(as_leaf(current), nth);
+	}
+
+	iterator insert(const_iterator it, size_type count, bool value)
+	{
+		check_iterator(it);
+
+		const auto index = static_cast<size_type>(it - cbegin());
+		splice(index, bits_source{ nullptr, 0, value }, count);
+		return iterator{ *this, index };
+	}
+	iterator insert(const_iterator it, bool value) { return insert(it, 1, value); }
+	template<typename InputIt, typename = has_iterator_type<InputIt>>
+	iterator insert(const_iterator it, InputIt first, InputIt last)
+	{
+		check_iterator(it);
+
+		const auto index = static_cast<size_type>(it - cbegin());
+		std::vector<word_type> words;
+		size_type count = 0;
+		for (; first != last; ++first, ++count) {
+			if (count % word_bits == 0) words.push_back(0);
+			if (bool(*first)) words.back() |= bit_mask<word_type>(count % word_bits);
+		}
+		splice(index, bits_source{ words.data() }, count);
+		return iterator{ *this, index };
+	}
+
+	iterator erase(const_iterator first, const_iterator last)
+	{
+		check_iterators_range(first, last);
+
+		const auto indexFirst = static_cast<size_type>(first - cbegin());
+		erase_range(indexFirst, static_cast<size_type>(last - first));
+		return iterator{ *this, indexFirst };
+	}
+	iterator erase(const_iterator it)
+	{
+		if (it < cbegin() || it >= cend()) throw std::out_of_range{ "iterator is out of range" };
+		const auto index = static_cast<size_type>(it - cbegin());
+		erase_range(index, 1);
+		return iterator{ *this, index };
+	}
+
+	void push_back(bool value) { insert_at(size_, value); }
+	void pop_back() { empty_check(); erase_range(size_ - 1, 1); }
+
+	void resize(size_type count, bool value)
+	{
+		if (count < size_) erase_range(count, size_ - count);
+		else splice(size_, bits_source{ nullptr, 0, value }, count - size_);
+	}
+	void resize(size_type count) { resize(count, false); }
+
+	size_type size() const { return size_; }
+	void clear()
+	{
+		destroy(root_, height_);
+		root_ = nullptr;
+		height_ = 0;
+		size_ = 0;
+		ones_ = 0;
+	}
+
+	void swap(bits_tree& other) noexcept
+	{
+		std::swap(root_, other.root_);
+		std::swap(height_, other.height_);
+		std::swap(size_, other.size_);
+		std::swap(ones_, other.ones_);
+	}
+	friend void swap(bits_tree& left, bits_tree& right) noexcept { left.swap(right); }
+
+	iterator begin() { return iterator{ *this, 0 }; }
+	iterator end() { return iterator{ *this, size_ }; }
+
+	const_iterator cbegin() const { return const_iterator{ *this, 0 }; }
+	const_iterator cend() const { return const_iterator{ *this, size_ }; }
+
+	const_iterator begin() const { return cbegin(); }
+	const_iterator end() const { return cend(); }
+
+private: // reference implementation
+	class reference_impl {
+		friend class bits_tree;
+		friend class iterator_impl;
+	private:
+		explicit reference_impl(bits_tree& context, size_type index)
+			: context_{ &context }, index_{ index } {}
+	public:
+		reference_impl(const reference_impl&) = default;
+
+		// const as proxy writes through const references are required by std::indirectly_writable
+		const reference_impl& operator=(bool value) const
+		{
+			context_->set(index_, value);
+			return *this;
+		}
+		reference_impl& operator=(const reference_impl& other) { *this = bool(other); return *this; }
+		operator bool() const { assert(context_ != nullptr); return context_->get(index_); }
+		friend void swap(reference_impl left, reference_impl right)
+		{
+			const bool tmp = bool(left);
+			left = bool(right);
+			right = tmp;
+		}
+
+	private:
+		bits_tree* context_ = nullptr;
+		size_type index_ = 0;
+	};
+
+private: // iterators
+	class iterator_impl {
+		friend class bits_tree;
+		friend class const_iterator_impl;
+
+		explicit iterator_impl(bits_tree& context, size_type index)
+			: context_{ &context }, index_{ static_cast<difference_type>(index) } {}
+
+	public:
+		using iterator_concept = std::random_access_iterator_tag;
+		using iterator_category = std::random_access_iterator_tag;
+		using value_type = bool;
+		using difference_type = bits_tree::difference_type;
+		using pointer = void;
+		using reference = reference_impl;
+
+		iterator_impl() = default;
+
+		iterator_impl& operator++() { ++index_; return *this; }
+		iterator_impl operator++(int) { auto result = *this; ++(*this); return result; }
+
+		iterator_impl& operator--() { --index_; return *this; }
+		iterator_impl operator--(int) { auto result = *this; --(*this); return result; }
+
+		iterator_impl& operator+=(difference_type shift) { index_ += shift; return *this; }
+		iterator_impl operator+(difference_type shift) const { auto result = *this; result += shift; return result; }
+		friend iterator_impl operator+(difference_type shift, iterator_impl it) { return it + shift; }
+
+		iterator_impl& operator-=(difference_type shift) { index_ -= shift; return *this; }
+		iterator_impl operator-(difference_type shift) const { auto result = *this; result -= shift; return result; }
+
+		difference_type operator-(iterator_impl other) const { return index_ - other.index_; }
+
+		reference_impl operator*() const
+		{
+			assert(context_ != nullptr);
+			assert((index_ >= 0 && static_cast<size_type>(index_) < context_->size_));
+			return reference_impl{ *context_, static_cast<size_type>(index_) };
+		}
+		reference_impl operator[](difference_type n) const { return *(*this + n); }
+
+		bool operator<(iterator_impl other) const { return (*this - other) < 0; }
+		bool operator>(iterator_impl other) const { return (*this - other) > 0; }
+
+		bool operator==(iterator_impl other) const { return (*this - other) == 0; }
+		bool operator!=(iterator_impl other) const { return !(*this == other); }
+
+		bool operator<=(iterator_impl other) const { return !(*this > other); }
+		bool operator>=(iterator_impl other) const { return !(*this < other); }
+
+	private:
+		bits_tree* context_ = nullptr;
+		difference_type index_ = 0;
+	};
+
+	class const_iterator_impl {
+		friend class bits_tree;
+
+		explicit const_iterator_impl(const bits_tree& context, size_type index)
+			: context_{ &context }, index_{ static_cast<difference_type>(index) } {}
+
+	public:
+		using iterator_concept = std::random_access_iterator_tag;
+		using iterator_category = std::random_access_iterator_tag;
+		using value_type = bool;
+		using difference_type = bits_tree::difference_type;
+		using pointer = void;
+		using reference = bool;
+
+		const_iterator_impl() = default;
+		const_iterator_impl(const iterator_impl& other)
+			: context_{ other.context_ }, index_{ other.index_ } {}
+
+		const_iterator_impl& operator++() { ++index_; return *this; }
+		const_iterator_impl operator++(int) { auto result = *this; ++(*this); return result; }
+
+		const_iterator_impl& operator--() { --index_; return *this; }
+		const_iterator_impl operator--(int) { auto result = *this; --(*this); return result; }
+
+		const_iterator_impl& operator+=(difference_type shift) { index_ += shift; return *this; }
+		const_iterator_impl operator+(difference_type shift) const { auto result = *this; result += shift; return result; }
+		friend const_iterator_impl operator+(difference_type shift, const_iterator_impl it) { return it + shift; }
+
+		const_iterator_impl& operator-=(difference_type shift) { index_ -= shift; return *this; }
+		const_iterator_impl operator-(difference_type shift) const { auto result = *this; result -= shift; return result; }
+
+		difference_type operator-(const_iterator_impl other) const { return index_ - other.index_; }
+
+		bool operator*() const
+		{
+			assert(context_ != nullptr);
+			assert((index_ >= 0 && static_cast<size_type>(index_) < context_->size_));
+			return context_->get(static_cast<size_type>(index_));
+		}
+		bool operator[](difference_type n) const { return *(*this + n); }
+
+		bool operator<(const_iterator_impl other) const { return (*this - other) < 0; }
+		bool operator>(const_iterator_impl other) const { return (*this - other) > 0; }
+
+		bool operator==(const_iterator_impl other) const { return (*this - other) == 0; }
+		bool operator!=(const_iterator_impl other) const { return !(*this == other); }
+
+		bool operator<=(const_iterator_impl other) const { return !(*this > other); }
+		bool operator>=(const_iterator_impl other) const { return !(*this < other); }
+
+	private:
+		const bits_tree* context_ = nullptr;
+		difference_type index_ = 0;
+	};
+
+private: // nodes
+	// leaves hold only bits, their sizes are kept by the parent or by the tree for the root leaf
+	struct alignas(cache_line_size) leaf_node {
+		std::array<word_type, leaf_words> words{};
+	};
+	static_assert(sizeof(leaf_node) == cache_line_size, "leaf must fill exactly one cache line");
+
+	// children are leaves or inner nodes depending on the height, which every traversal knows
+	struct inner_node {
+		std::array<void*, inner_max_children> children{};
+		std::array<size_type, inner_max_children> sizes{};
+		std::array<size_type, inner_max_children> ones{};
+		size_type count = 0;
+	};
+
+	struct node_stats {
+		size_type size = 0;
+		size_type ones = 0;
+	};
+
+	static leaf_node& as_leaf(void* n) { return *static_cast<leaf_node*>(n); }
+	static const leaf_node& as_leaf(const void* n) { return *static_cast<const leaf_node*>(n); }
+	static inner_node& as_inner(void* n) { return *static_cast<inner_node*>(n); }
+	static const inner_node& as_inner(const void* n) { return *static_cast<const inner_node*>(n); }
+
+	static void destroy(void* n, size_type height) noexcept
+	{
+		if (n == nullptr) return;
+		if (height == 0) {
+			delete static_cast<leaf_node*>(n);
+			return;
+		}
+
+		auto* inner = static_cast<inner_node*>(n);
+		for (size_type i = 0; i < inner->count; ++i) destroy(inner->children[i], height - 1);
+		delete inner;
+	}
+
+	static void* clone(const void* from, size_type height)
+	{
+		if (height == 0) return new leaf_node(as_leaf(from));
+
+		const auto& inner = as_inner(from);
+		auto* result = new inner_node();
+		try {
+			for (; result->count < inner.count; ++result->count) {
+				result->children[result->count] = clone(inner.children[result->count], height - 1);
+			}
+		}
+		catch (...) {
+			destroy(result, height);
+			throw;
+		}
+		result->sizes = inner.sizes;
+		result->ones = inner.ones;
+		return result;
+	}
+
+	// owning list of neighbour nodes of the same height with their sizes and counts of set bits
+	struct node_list {
+		explicit node_list(size_type h) : height{ h } {}
+		node_list(const node_list&) = delete;
+		node_list& operator=(const node_list&) = delete;
+		~node_list() { for (auto n : nodes) destroy(n, height); }
+
+		size_type size() const { return nodes.size(); }
+		bool empty() const { return nodes.empty(); }
+
+		void reserve(size_type count)
+		{
+			nodes.reserve(count);
+			sizes.reserve(count);
+			ones.reserve(count);
+		}
+
+		// capacity must be reserved, so taking ownership never throws
+		void push_back(void* n, node_stats stats)
+		{
+			assert(nodes.size() < nodes.capacity());
+			nodes.push_back(n);
+			sizes.push_back(stats.size);
+			ones.push_back(stats.ones);
+		}
+
+		template<class Node>
+		Node& emplace_back()
+		{
+			sizes.push_back(0);
+			ones.push_back(0);
+			nodes.push_back(nullptr);
+			auto* result = new Node{};
+			nodes.back() = result;
+			return *result;
+		}
+
+		node_stats stats(size_type index) const { return { sizes[index], ones[index] }; }
+		void* release(size_type index) { return std::exchange(nodes[index], nullptr); }
+
+		void swap(node_list& other) noexcept
+		{
+			std::swap(nodes, other.nodes);
+			std::swap(sizes, other.sizes);
+			std::swap(ones, other.ones);
+			std::swap(height, other.height);
+		}
+
+		std::vector<void*> nodes;
+		std::vector<size_type> sizes;
+		std::vector<size_type> ones;
+		size_type height = 0;
+	};
+
+	static size_type inner_size(const inner_node& inner)
+	{
+		size_type result = 0;
+		for (size_type i = 0; i < inner.count; ++i) result += inner.sizes[i];
+		return result;
+	}
+
+	static size_type inner_ones(const inner_node& inner)
+	{
+		size_type result = 0;
+		for (size_type i = 0; i < inner.count; ++i) result += inner.ones[i];
+		return result;
+	}
+
+	static bool child_underflow(const inner_node& inner, size_type index, size_type childHeight)
+	{
+		return (childHeight == 0)
+			? inner.sizes[index] < leaf_min_bits
+			: as_inner(inner.children[index]).count < inner_min_children;
+	}
+
+private: // leaf operations
+	// bits past the leaf size are always zero
+	static bool leaf_get(const leaf_node& leaf, size_type index) { return (leaf.words[index / word_bits] & bit_mask<word_type>(index % word_bits)) != 0; }
+
+	static bool leaf_set(leaf_node& leaf, size_type index, bool value)
+	{
+		auto& word = leaf.words[index / word_bits];
+		const auto mask = bit_mask<word_type>(index % word_bits);
+		const bool old = (word & mask) != 0;
+		word = value ? (word | mask) : (word & ~mask);
+		return old;
+	}
+
+	static void leaf_insert(leaf_node& leaf, size_type index, bool value)
+	{
+		auto& words = leaf.words;
+		const auto wordIndex = index / word_bits;
+		for (auto i = leaf_words - 1; i > wordIndex; --i) {
+			words[i] = (words[i] >> 1) | (words[i - 1] << (word_bits - 1));
+		}
+
+		const auto head = high_bits_mask<word_type>(index % word_bits);
+		const auto mask = bit_mask<word_type>(index % word_bits);
+		words[wordIndex] = (words[wordIndex] & head) | ((words[wordIndex] >> 1) & ~head & ~mask);
+		if (value) words[wordIndex] |= mask;
+	}
+
+	static bool leaf_erase(leaf_node& leaf, size_type index)
+	{
+		auto& words = leaf.words;
+		const auto wordIndex = index / word_bits;
+		const bool value = leaf_get(leaf, index);
+
+		const auto head = high_bits_mask<word_type>(index % word_bits);
+		words[wordIndex] = (words[wordIndex] & head) | ((words[wordIndex] << 1) & ~head);
+		for (auto i = wordIndex; i + 1 < leaf_words; ++i) {
+			words[i] |= words[i + 1] >> (word_bits - 1);
+			words[i + 1] <<= 1;
+		}
+		return value;
+	}
+
+	static size_type leaf_rank(const leaf_node& leaf, size_type index)
+	{
+		const auto wordIndex = index / word_bits;
+		size_type result = 0;
+		for (size_type i = 0; i < wordIndex; ++i) result += count_set_bits(leaf.words[i]);
+		if (index % word_bits != 0) result += count_set_bits(leaf.words[wordIndex] & high_bits_mask<word_type>(index % word_bits));
+		return result;
+	}
+
+	static size_type leaf_ones(const leaf_node& leaf)
+	{
+		size_type result = 0;
+		for (auto word : leaf.words) result += count_set_bits(word);
+		return result;
+	}
+
+	static size_type leaf_select(const leaf_node& leaf, size_type nth)
+	{
+		for (size_type i = 0; i < leaf_words; ++i) {
+			const auto word = leaf.words[i];
+			const auto ones = count_set_bits(word);
+			if (nth >= ones) {
+				nth -= ones;
+				continue;
+			}
+
+			for (size_type bit = 0;; ++bit) {
+				if ((word & bit_mask<word_type>(bit)) && nth-- == 0) return i * word_bits + bit;
+			}
+		}
+
+		assert(false);
+		return leaf_max_bits;
+	}
+
+	// copies count bits from src starting at srcIndex to dst starting at dstIndex
+	static void copy_bits(const word_type* src, size_type srcIndex, word_type* dst, size_type dstIndex, size_type count)
+	{
+		while (count > 0) {
+			const auto srcOffset = srcIndex % word_bits;
+			const auto dstOffset = dstIndex % word_bits;
+			const auto chunk = std::min({ count, word_bits - srcOffset, word_bits - dstOffset });
+			const auto mask = high_bits_mask<word_type>(chunk);
+
+			const auto bits = (src[srcIndex / word_bits] << srcOffset) & mask;
+			auto& word = dst[dstIndex / word_bits];
+			word = (word & ~(mask >> dstOffset)) | (bits >> dstOffset);
+
+			srcIndex += chunk;
+			dstIndex += chunk;
+			count -= chunk;
+		}
+	}
+
+	// inserted bits: packed words starting at offset, or copies of value when there are no words
+	struct bits_source {
+		const word_type* words = nullptr;
+		size_type offset = 0;
+		bool value = false;
+
+		bool get(size_type index) const
+		{
+			return (words == nullptr) ? value : (words[(offset + index) / word_bits] & bit_mask<word_type>((offset + index) % word_bits)) != 0;
+		}
+
+		void copy_to(size_type index, word_type* dst, size_type dstIndex, size_type count) const
+		{
+			if (words == nullptr) fill_bits(dst, dstIndex, dstIndex + count, value);
+			else copy_bits(words, offset + index, dst, dstIndex, count);
+		}
+	};
+
+	// copies [first, last) of the leaf bits with count source bits inserted at index
+	static void copy_spliced(const word_type* leaf, size_type index, const bits_source& src, size_type count,
+		size_type first, size_type last, word_type* dst)
+	{
+		size_type out = 0;
+		if (first < index) {
+			const auto chunk = std::min(last, index) - first;
+			copy_bits(leaf, first, dst, out, chunk);
+			out += chunk;
+			first += chunk;
+		}
+		if (first < last && first < index + count) {
+			const auto chunk = std::min(last, index + count) - first;
+			src.copy_to(first - index, dst, out, chunk);
+			out += chunk;
+			first += chunk;
+		}
+		if (first < last) copy_bits(leaf, first - count, dst, out, last - first);
+	}
+
+	// inserts count source bits at index of the leaf holding size bits,
+	// when they do not fit the bits are spread over evenly filled new leaves appended to siblings
+	static node_stats splice_leaf(leaf_node& leaf, size_type size, size_type index,
+		const bits_source& src, size_type count, node_list& siblings)
+	{
+		const auto total = size + count;
+		if (total <= leaf_max_bits) {
+			if (count == 1) {
+				leaf_insert(leaf, index, src.get(0));
+			}
+			else {
+				std::array<word_type, leaf_words> buffer{};
+				copy_spliced(leaf.words.data(), index, src, count, 0, total, buffer.data());
+				leaf.words = buffer;
+			}
+			return { total, leaf_ones(leaf) };
+		}
+
+		const auto leavesCount = (total + leaf_max_bits - 1) / leaf_max_bits;
+		const auto firstSibling = siblings.size();
+		for (size_type i = 1; i < leavesCount; ++i) siblings.emplace_back<leaf_node>();
+
+		const auto original = leaf.words;
+		for (size_type i = 0; i < leavesCount; ++i) {
+			const auto first = total * i / leavesCount;
+			const auto last = total * (i + 1) / leavesCount;
+
+			auto& target = (i == 0) ? leaf : as_leaf(siblings.nodes[firstSibling + i - 1]);
+			target.words.fill(0);
+			copy_spliced(original.data(), index, src, count, first, last, target.words.data());
+			if (i > 0) {
+				siblings.sizes[firstSibling + i - 1] = last - first;
+				siblings.ones[firstSibling + i - 1] = leaf_ones(target);
+			}
+		}
+		return { total / leavesCount, leaf_ones(leaf) };
+	}
+
+	// erases count bits starting at index of the leaf holding size bits, returns number of erased set bits
+	static size_type leaf_erase_range(leaf_node& leaf, size_type size, size_type index, size_type count)
+	{
+		assert(index + count <= size);
+		if (count == 1) return leaf_erase(leaf, index);
+
+		const auto ones = leaf_ones(leaf);
+		std::array<word_type, leaf_words> buffer{};
+		copy_bits(leaf.words.data(), 0, buffer.data(), 0, index);
+		copy_bits(leaf.words.data(), index + count, buffer.data(), index, size - index - count);
+		leaf.words = buffer;
+		return ones - leaf_ones(leaf);
+	}
+
+	// moves bits between neighbour leaves of the node, merging them if they fit into one
+	static void rebalance_leaves(inner_node& inner, size_type leftIndex)
+	{
+		const auto rightIndex = leftIndex + 1;
+		auto& left = as_leaf(inner.children[leftIndex]);
+		auto& right = as_leaf(inner.children[rightIndex]);
+
+		std::array<word_type, 2 * leaf_words> buffer{};
+		copy_bits(left.words.data(), 0, buffer.data(), 0, inner.sizes[leftIndex]);
+		copy_bits(right.words.data(), 0, buffer.data(), inner.sizes[leftIndex], inner.sizes[rightIndex]);
+
+		const auto total = inner.sizes[leftIndex] + inner.sizes[rightIndex];
+		const auto leftSize = (total <= leaf_max_bits) ? total : total / 2;
+
+		left.words.fill(0);
+		right.words.fill(0);
+		copy_bits(buffer.data(), 0, left.words.data(), 0, leftSize);
+		copy_bits(buffer.data(), leftSize, right.words.data(), 0, total - leftSize);
+		inner.sizes[leftIndex] = leftSize;
+		inner.ones[leftIndex] = leaf_ones(left);
+		inner.sizes[rightIndex] = total - leftSize;
+		inner.ones[rightIndex] = leaf_ones(right);
+	}
+
+private: // inner node operations
+	// returns index of the child containing position and position inside that child
+	static std::pair<size_type, size_type> find_child(const inner_node& inner, size_type index, bool forInsert)
+	{
+		size_type i = 0;
+		for (; i + 1 < inner.count && index >= inner.sizes[i] + (forInsert ? 1 : 0); ++i) {
+			index -= inner.sizes[i];
+		}
+		return { i, index };
+	}
+
+	static void insert_child(inner_node& inner, size_type index, void* child, node_stats stats)
+	{
+		assert(inner.count < inner_max_children && index <= inner.count);
+
+		for (auto i = inner.count; i > index; --i) {
+			inner.children[i] = inner.children[i - 1];
+			inner.sizes[i] = inner.sizes[i - 1];
+			inner.ones[i] = inner.ones[i - 1];
+		}
+		inner.children[index] = child;
+		inner.sizes[index] = stats.size;
+		inner.ones[index] = stats.ones;
+		++inner.count;
+	}
+
+	static void* remove_child(inner_node& inner, size_type index)
+	{
+		assert(index < inner.count);
+
+		auto result = inner.children[index];
+		for (auto i = index; i + 1 < inner.count; ++i) {
+			inner.children[i] = inner.children[i + 1];
+			inner.sizes[i] = inner.sizes[i + 1];
+			inner.ones[i] = inner.ones[i + 1];
+		}
+		--inner.count;
+		inner.children[inner.count] = nullptr;
+		inner.sizes[inner.count] = 0;
+		inner.ones[inner.count] = 0;
+		return result;
+	}
+
+	// moves children between neighbour inner nodes, leaving right node empty if they fit into one
+	static void rebalance_inners(inner_node& left, inner_node& right)
+	{
+		const auto total = left.count + right.count;
+		const auto leftCount = (total <= inner_max_children) ? total : total / 2;
+
+		while (left.count < leftCount) {
+			const node_stats stats{ right.sizes[0], right.ones[0] };
+			insert_child(left, left.count, remove_child(right, 0), stats);
+		}
+		while (left.count > leftCount) {
+			const auto last = left.count - 1;
+			const node_stats stats{ left.sizes[last], left.ones[last] };
+			insert_child(right, 0, remove_child(left, last), stats);
+		}
+	}
+
+	// rebalances child with its neighbour, returns index of the left one of them
+	static size_type rebalance_children(inner_node& inner, size_type index, size_type childHeight)
+	{
+		assert(inner.count > 1);
+
+		const auto leftIndex = (index + 1 < inner.count) ? index : index - 1;
+		const auto rightIndex = leftIndex + 1;
+		if (childHeight == 0) {
+			rebalance_leaves(inner, leftIndex);
+		}
+		else {
+			auto& left = as_inner(inner.children[leftIndex]);
+			auto& right = as_inner(inner.children[rightIndex]);
+			rebalance_inners(left, right);
+
+			// grandchildren of a node left with a single child could not be fixed before
+			fix_children(left, childHeight - 1);
+			fix_children(right, childHeight - 1);
+			inner.sizes[leftIndex] = inner_size(left);
+			inner.ones[leftIndex] = inner_ones(left);
+			inner.sizes[rightIndex] = inner_size(right);
+			inner.ones[rightIndex] = inner_ones(right);
+		}
+
+		if (inner.sizes[rightIndex] == 0) destroy(remove_child(inner, rightIndex), childHeight);
+		return leftIndex;
+	}
+
+	// merges or rebalances underflowing children with their neighbours
+	static void fix_children(inner_node& inner, size_type childHeight)
+	{
+		size_type i = 0;
+		while (i < inner.count && inner.count > 1) {
+			if (!child_underflow(inner, i, childHeight)) {
+				++i;
+				continue;
+			}
+
+			const auto leftIndex = rebalance_children(inner, i, childHeight);
+			i = (leftIndex > 0) ? leftIndex - 1 : 0;
+		}
+	}
+
+	// groups nodes into evenly filled parents level by level until a single root remains
+	static void* build_levels(node_list& level)
+	{
+		assert(!level.empty());
+
+		while (level.size() > 1) {
+			node_list parents{ level.height + 1 };
+			const auto parentsCount = (level.size() + inner_max_children - 1) / inner_max_children;
+			parents.reserve(parentsCount);
+			for (size_type i = 0; i < parentsCount; ++i) {
+				const auto first = level.size() * i / parentsCount;
+				const auto last = level.size() * (i + 1) / parentsCount;
+
+				auto& parent = parents.emplace_back<inner_node>();
+				for (auto j = first; j < last; ++j) {
+					insert_child(parent, parent.count, level.release(j), level.stats(j));
+				}
+				parents.sizes.back() = inner_size(parent);
+				parents.ones.back() = inner_ones(parent);
+			}
+			level.swap(parents);
+		}
+		return level.release(0);
+	}
+
+private: // tree operations
+	static bool get_rec(const void* n, size_type height, size_type index)
+	{
+		for (; height > 0; --height) {
+			const auto& inner = as_inner(n);
+			const auto [childIndex, childPos] = find_child(inner, index, false);
+			n = inner.children[childIndex];
+			index = childPos;
+		}
+		return leaf_get(as_leaf(n), index);
+	}
+
+	static bool set_rec(void* n, size_type height, size_type index, bool value)
+	{
+		if (height == 0) return leaf_set(as_leaf(n), index, value);
+
+		auto& inner = as_inner(n);
+		const auto [childIndex, childPos] = find_child(inner, index, false);
+		const bool old = set_rec(inner.children[childIndex], height - 1, childPos, value);
+		inner.ones[childIndex] = inner.ones[childIndex] + value - old;
+		return old;
+	}
+
+	// inserts count source bits at index of the node holding size bits, nodes split off are appended to siblings
+	static node_stats splice_rec(void* n, size_type height, size_type size, size_type index,
+		const bits_source& src, size_type count, node_list& siblings)
+	{
+		if (height == 0) return splice_leaf(as_leaf(n), size, index, src, count, siblings);
+
+		auto& inner = as_inner(n);
+		const auto [childIndex, childPos] = find_child(inner, index, true);
+		node_list childSiblings{ height - 1 };
+		const auto child = splice_rec(inner.children[childIndex], height - 1, inner.sizes[childIndex], childPos, src, count, childSiblings);
+		inner.sizes[childIndex] = child.size;
+		inner.ones[childIndex] = child.ones;
+
+		if (inner.count + childSiblings.size() <= inner_max_children) {
+			for (size_type i = 0; i < childSiblings.size(); ++i) {
+				insert_child(inner, childIndex + 1 + i, childSiblings.release(i), childSiblings.stats(i));
+			}
+			return { inner_size(inner), inner_ones(inner) };
+		}
+
+		// children do not fit, spread them over evenly filled new nodes
+		const auto total = inner.count + childSiblings.size();
+		const auto nodesCount = (total + inner_max_children - 1) / inner_max_children;
+		std::vector<void*> children;
+		std::vector<node_stats> stats;
+		children.reserve(total);
+		stats.reserve(total);
+		const auto firstSibling = siblings.size();
+		for (size_type i = 1; i < nodesCount; ++i) siblings.emplace_back<inner_node>();
+
+		for (size_type i = 0; i < inner.count; ++i) {
+			children.push_back(inner.children[i]);
+			stats.push_back({ inner.sizes[i], inner.ones[i] });
+			if (i == childIndex) {
+				for (size_type j = 0; j < childSiblings.size(); ++j) {
+					children.push_back(childSiblings.release(j));
+					stats.push_back(childSiblings.stats(j));
+				}
+			}
+		}
+
+		inner = inner_node{};
+		for (size_type i = 0; i < nodesCount; ++i) {
+			const auto first = total * i / nodesCount;
+			const auto last = total * (i + 1) / nodesCount;
+
+			auto& target = (i == 0) ? inner : as_inner(siblings.nodes[firstSibling + i - 1]);
+			for (auto j = first; j < last; ++j) insert_child(target, target.count, children[j], stats[j]);
+			if (i > 0) {
+				siblings.sizes[firstSibling + i - 1] = inner_size(target);
+				siblings.ones[firstSibling + i - 1] = inner_ones(target);
+			}
+		}
+		return { inner_size(inner), inner_ones(inner) };
+	}
+
+	// erases count bits starting at index of the node holding size bits, returns number of erased set bits
+	static size_type erase_rec(void* n, size_type height, size_type size, size_type index, size_type count)
+	{
+		if (height == 0) return leaf_erase_range(as_leaf(n), size, index, count);
+
+		auto& inner = as_inner(n);
+		size_type erased = 0;
+		size_type kept = 0;
+		size_type offset = 0;
+		bool underflow = false;
+		for (size_type i = 0; i < inner.count; ++i) {
+			const auto childSize = inner.sizes[i];
+			const auto first = std::max(index, offset);
+			const auto last = std::min(index + count, offset + childSize);
+
+			if (first < last && last - first == childSize) {
+				// whole subtree is erased without visiting it
+				erased += inner.ones[i];
+				destroy(inner.children[i], height - 1);
+			}
+			else {
+				if (first < last) {
+					const auto childErased = erase_rec(inner.children[i], height - 1, childSize, first - offset, last - first);
+					inner.sizes[i] -= last - first;
+					inner.ones[i] -= childErased;
+					erased += childErased;
+				}
+				inner.children[kept] = inner.children[i];
+				inner.sizes[kept] = inner.sizes[i];
+				inner.ones[kept] = inner.ones[i];
+				underflow = underflow || child_underflow(inner, kept, height - 1);
+				++kept;
+			}
+			offset += childSize;
+		}
+
+		for (auto i = kept; i < inner.count; ++i) {
+			inner.children[i] = nullptr;
+			inner.sizes[i] = 0;
+			inner.ones[i] = 0;
+		}
+		inner.count = kept;
+
+		if (underflow) fix_children(inner, height - 1);
+		return erased;
+	}
+
+	bool get(size_type index) const { assert(index < size_); return get_rec(root_, height_, index); }
+
+	void set(size_type index, bool value)
+	{
+		assert(index < size_);
+		const bool old = set_rec(root_, height_, index, value);
+		ones_ = ones_ + value - old;
+	}
+
+	// inserts count source bits at index, O(count / leaf_max_bits + log n)
+	void splice(size_type index, const bits_source& src, size_type count)
+	{
+		assert(index <= size_);
+		if (count == 0) return;
+		if (root_ == nullptr) root_ = new leaf_node{};
+
+		node_list siblings{ height_ };
+		const auto rootStats = splice_rec(root_, height_, size_, index, src, count, siblings);
+		size_ += count;
+		ones_ = rootStats.ones;
+		for (size_type i = 0; i < siblings.size(); ++i) ones_ += siblings.ones[i];
+		if (siblings.empty()) return;
+
+		node_list level{ height_ };
+		level.reserve(siblings.size() + 1);
+		level.push_back(std::exchange(root_, nullptr), rootStats);
+		for (size_type i = 0; i < siblings.size(); ++i) level.push_back(siblings.release(i), siblings.stats(i));
+		root_ = build_levels(level);
+		height_ = level.height;
+	}
+
+	// erases count bits starting at index, whole subtrees inside the range are dropped without visiting them
+	void erase_range(size_type index, size_type count)
+	{
+		assert(index + count <= size_);
+		if (count == 0) return;
+		if (count == size_) {
+			clear();
+			return;
+		}
+
+		ones_ -= erase_rec(root_, height_, size_, index, count);
+		size_ -= count;
+		while (height_ > 0 && as_inner(root_).count == 1) {
+			auto* oldRoot = static_cast<inner_node*>(root_);
+			root_ = remove_child(*oldRoot, 0);
+			delete oldRoot;
+			--height_;
+		}
+	}
+
+	void insert_at(size_type index, bool value) { splice(index, bits_source{ nullptr, 0, value }, 1); }
+
+private: // bulk operations
+	// copies all bits to zero initialized words
+	void copy_to_words(word_type* words) const
+	{
+		if (root_) copy_leaves(root_, height_, size_, words, 0);
+	}
+
+	static size_type copy_leaves(const void* n, size_type height, size_type size, word_type* words, size_type offset)
+	{
+		if (height == 0) {
+			copy_bits(as_leaf(n).words.data(), 0, words, offset, size);
+			return offset + size;
+		}
+
+		const auto& inner = as_inner(n);
+		for (size_type i = 0; i < inner.count; ++i) {
+			offset = copy_leaves(inner.children[i], height - 1, inner.sizes[i], words, offset);
+		}
+		return offset;
+	}
+
+	// replaces content with count bits from words, building the tree bottom up with evenly filled nodes
+	void assign_words(const word_type* words, size_type count)
+	{
+		clear();
+		splice(0, bits_source{ words }, count);
+	}
+
+private:
+	void check_index(size_type index) const { if (index >= size_) throw std::out_of_range{ "index is out of range" }; }
+	void empty_check() const { if (empty()) throw std::out_of_range{ "container is empty" }; }
+	void check_iterator(const_iterator it) const { if (it < cbegin() || it > cend()) throw std::out_of_range{ "iterator is out of range" }; }
+	void check_iterators_range(const_iterator first, const_iterator last) const
+	{
+		if (first > last || first < cbegin() || last > cend()) throw std::out_of_range{ "invalid iterators range" };
+	}
+
+private:
+	void* root_ = nullptr;
+	size_type height_{ 0 };
+	size_type size_{ 0 };
+	size_type ones_{ 0 };
+};
+
+#endif // !BITS_TREE_HPP
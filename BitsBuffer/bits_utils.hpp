@@ -3,23 +3,70 @@
 #define BITS_UTILS_HPP
 
 #include <type_traits>
+#include <cstdint>
+#include <cstddef>
+#include <iterator>
+#include <bit>
+
+
+template<typename InputIt>
+using has_iterator_type = std::enable_if_t<
+	std::is_same_v<
+	typename std::iterator_traits<InputIt>::iterator_category,
+	typename std::iterator_traits<InputIt>::iterator_category
+	>
+>;
+
+
+// smallest unsigned type with at least Bits bits
+template<std::size_t Bits>
+using smallest_unsigned_type = std::conditional_t<(Bits <= 8), std::uint8_t,
+	std::conditional_t<(Bits <= 16), std::uint16_t,
+	std::conditional_t<(Bits <= 32), std::uint32_t, std::uint64_t>>>;
+
+
+// mask with count most significant bits set, count may be equal to bits count of T
+template<typename T, typename = std::enable_if_t<std::is_unsigned_v<T>>>
+constexpr inline T high_bits_mask(std::size_t count) noexcept
+{
+	return (count == 0) ? T{ 0 } : static_cast<T>(static_cast<T>(~T{ 0 }) << ((8*sizeof(T)) - count));
+}
+
+// shifts which give zero instead of undefined behaviour when shift is equal to bits count of T
+template<typename T, typename = std::enable_if_t<std::is_unsigned_v<T>>>
+constexpr inline T shift_left(T bits, std::size_t shift) noexcept
+{
+	return (shift >= 8*sizeof(T)) ? T{ 0 } : static_cast<T>(bits << shift);
+}
+
+template<typename T, typename = std::enable_if_t<std::is_unsigned_v<T>>>
+constexpr inline T shift_right(T bits, std::size_t shift) noexcept
+{
+	return (shift >= 8*sizeof(T)) ? T{ 0 } : static_cast<T>(bits >> shift);
+}
+
+template<typename T, typename = std::enable_if_t<std::is_unsigned_v<T>>>
+constexpr inline T bit_mask(std::size_t index) noexcept
+{
+	return static_cast<T>(T{ 1 } << ((8*sizeof(T)) - index - 1));
+}
 
 template<typename T, typename = std::enable_if_t<std::is_unsigned_v<T>>>
 constexpr inline bool get_bit(T bits, std::size_t index) noexcept
 {
-	return bits & (1 << ((8*sizeof(T)) - index - 1));
+	return bits & bit_mask<T>(index);
 }
 
 template<typename T, typename = std::enable_if_t<std::is_unsigned_v<T>>>
 constexpr inline T clear_bit(T bits, std::size_t index) noexcept
 {
-	return bits & (~(1 << ((8*sizeof(T)) - index - 1)));
+	return bits & static_cast<T>(~bit_mask<T>(index));
 }
 
 template<typename T, typename = std::enable_if_t<std::is_unsigned_v<T>>>
 constexpr inline T set_bit(T bits, std::size_t index, bool value) noexcept
 {
-	return (bits & (~(1 << ((8*sizeof(T)) - index - 1)))) | (value << ((8*sizeof(T)) - index - 1)); // set bit
+	return clear_bit(bits, index) | (value ? bit_mask<T>(index) : T{ 0 }); // set bit
 }
 
 /*
@@ -62,8 +109,20 @@ constexpr T insert_bits(T bits, std::size_t index, std::size_t count, bool value
 template<typename T, typename = std::enable_if_t<std::is_unsigned_v<T>>>
 constexpr inline T insert_bits(T bits, std::size_t index, std::size_t count, bool value) noexcept
 {
-	return value ? (((bits >> count) | (((static_cast<T>(~0)) << ((8*sizeof(T)) - (index + count))))) & (bits | (((static_cast<T>(~0)) >> index))))
-		: ((bits >> count) & ((static_cast<T>(~0)) >> (index + count))) | (bits & ((static_cast<T>(~0)) << ((8*sizeof(T)) - index)));
+	return value ? ((shift_right(bits, count) | high_bits_mask<T>(index + count)) & (bits | static_cast<T>(~high_bits_mask<T>(index))))
+		: (shift_right(bits, count) & static_cast<T>(~high_bits_mask<T>(index + count))) | (bits & high_bits_mask<T>(index));
+}
+
+// insert_bits with position known at compile time, all masks are folded by the compiler
+template<std::size_t Index, std::size_t Count, typename T, typename = std::enable_if_t<std::is_unsigned_v<T>>>
+constexpr inline T insert_bits(T bits, bool value) noexcept
+{
+	static_assert(Index + Count <= 8*sizeof(T), "inserted bits are out of range");
+
+	constexpr T head = high_bits_mask<T>(Index);
+	constexpr T inserted = high_bits_mask<T>(Index + Count) & static_cast<T>(~head);
+	constexpr T tail = static_cast<T>(~(head | inserted));
+	return (bits & head) | (shift_right(bits, Count) & tail) | (value ? inserted : T{ 0 });
 }
 
 
@@ -92,7 +151,69 @@ constexpr T erase_bits(T bits, std::size_t index, std::size_t count) noexcept
 template<typename T, typename = std::enable_if_t<std::is_unsigned_v<T>>>
 constexpr inline T erase_bits(T bits, std::size_t index, std::size_t count) noexcept
 {
-	return (bits & ((static_cast<T>(~0)) << ((8*sizeof(T)) - index))) | ((bits << count) & ((static_cast<T>(~0)) >> index));
+	return (bits & high_bits_mask<T>(index)) | (shift_left(bits, count) & static_cast<T>(~high_bits_mask<T>(index)));
+}
+
+// erase_bits with position known at compile time
+template<std::size_t Index, std::size_t Count, typename T, typename = std::enable_if_t<std::is_unsigned_v<T>>>
+constexpr inline T erase_bits(T bits) noexcept
+{
+	static_assert(Index + Count <= 8*sizeof(T), "erased bits are out of range");
+
+	constexpr T head = high_bits_mask<T>(Index);
+	return (bits & head) | (shift_left(bits, Count) & static_cast<T>(~head));
+}
+
+template<std::size_t Index, typename T, typename = std::enable_if_t<std::is_unsigned_v<T>>>
+constexpr inline bool get_bit(T bits) noexcept
+{
+	static_assert(Index < 8*sizeof(T), "index is out of range");
+	return bits & bit_mask<T>(Index);
+}
+
+template<std::size_t Index, typename T, typename = std::enable_if_t<std::is_unsigned_v<T>>>
+constexpr inline T set_bit(T bits, bool value) noexcept
+{
+	static_assert(Index < 8*sizeof(T), "index is out of range");
+	constexpr T mask = bit_mask<T>(Index);
+	return (bits & static_cast<T>(~mask)) | (value ? mask : T{ 0 });
+}
+
+
+// sets bits [first, last) of the words to value, bit index counts from the most significant bit of the first word
+template<typename T, typename = std::enable_if_t<std::is_unsigned_v<T>>>
+constexpr inline void fill_bits(T* words, std::size_t first, std::size_t last, bool value) noexcept
+{
+	constexpr std::size_t bits_count = 8*sizeof(T);
+	while (first < last) {
+		const auto offset = first % bits_count;
+		const auto count = (last - first < bits_count - offset) ? last - first : bits_count - offset;
+		const auto mask = static_cast<T>(high_bits_mask<T>(count) >> offset);
+
+		auto& word = words[first / bits_count];
+		word = value ? static_cast<T>(word | mask) : static_cast<T>(word & ~mask);
+		first += count;
+	}
+}
+
+
+// population count, compiles to a single popcnt where the target has it
+template<typename T, typename = std::enable_if_t<std::is_unsigned_v<T>>>
+constexpr inline std::size_t count_set_bits(T bits) noexcept
+{
+	return static_cast<std::size_t>(std::popcount(bits));
+}
+
+
+// upper word of the hi:lo pair shifted left by shift, shift is in [0, 64]
+constexpr inline std::uint64_t funnel_shift_left(std::uint64_t hi, std::uint64_t lo, std::size_t shift) noexcept
+{
+#ifdef __SIZEOF_INT128__
+	__extension__ typedef unsigned __int128 uint128;
+	return static_cast<std::uint64_t>((((static_cast<uint128>(hi) << 64) | lo) << shift) >> 64);
+#else
+	return (shift == 0) ? hi : (shift == 64) ? lo : ((hi << shift) | (lo >> (64 - shift)));
+#endif
 }
 
 
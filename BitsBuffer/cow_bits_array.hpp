@@ -0,0 +1,344 @@
+#pragma once
+#ifndef COW_BITS_ARRAY_HPP
+#define COW_BITS_ARRAY_HPP
+
+#include "bits_utils.hpp"
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <algorithm>
+#include <stdexcept>
+#include <iterator>
+#include <cassert>
+
+
+// Bits container for one writer and many concurrent readers.
+// Bits are stored in page sized chunks shared between versions through reference counts.
+// The writer clones only the chunks it touches after publish(), readers take snapshots
+// of the last published version.
+//
+// snapshot() is lock-free: it takes no lock and never waits for the writer, it only retries
+// when publish() starts a new epoch between its two loads. The published version is a plain
+// atomic pointer, versions replaced by publish() are freed by a later publish() once every
+// reader that could still be taking a reference to them has left (two counters epoch scheme).
+class cow_bits_array {
+	class reference_impl;
+	class snapshot_impl;
+
+	friend class reference_impl;
+
+	using word_type = std::uint64_t;
+
+	static constexpr std::size_t word_bits = 8 * sizeof(word_type);
+	static constexpr std::size_t page_size = 4096;
+	static constexpr std::size_t chunk_words = page_size / sizeof(word_type);
+	static constexpr std::size_t chunk_bits = chunk_words * word_bits;
+
+	struct chunk {
+		std::array<word_type, chunk_words> words{};
+	};
+
+	struct version : std::enable_shared_from_this<version> {
+		std::vector<std::shared_ptr<const chunk>> chunks;
+		std::size_t size = 0;
+
+		bool get(std::size_t index) const
+		{
+			assert(index < size);
+			return get_bit(chunks, index);
+		}
+	};
+
+	struct retired_version {
+		std::shared_ptr<const version> ver;
+		std::uint64_t epoch = 0;
+	};
+
+public:
+	using value_type = bool;
+	using size_type = std::size_t;
+	using difference_type = std::ptrdiff_t;
+	using reference = reference_impl;
+	using const_reference = bool;
+	using snapshot_type = snapshot_impl;
+
+public:
+	explicit cow_bits_array() : current_{ std::make_shared<const version>() }, published_{ current_.get() } {}
+	explicit cow_bits_array(size_type sz) : cow_bits_array(sz, false) {}
+	explicit cow_bits_array(size_type sz, bool val) : cow_bits_array() { resize(sz, val); }
+
+	cow_bits_array(const cow_bits_array&) = delete;
+	cow_bits_array& operator=(const cow_bits_array&) = delete;
+
+	// writer side, must not be called concurrently
+	reference operator[](size_type index) { return reference{ *this, index }; }
+	bool operator[](size_type index) const { return get(index); }
+	reference at(size_type index) { check_index(index); return (*this)[index]; }
+	bool at(size_type index) const { check_index(index); return (*this)[index]; }
+	bool empty() const { return size_ == 0; }
+	size_type size() const { return size_; }
+
+	void push_back(bool value)
+	{
+		if (size_ == chunks_.size() * chunk_bits) append_chunk();
+		++size_;
+		set(size_ - 1, value);
+	}
+	void pop_back() { empty_check(); resize(size_ - 1); }
+
+	void resize(size_type count, bool value)
+	{
+		const auto chunksCount = (count + chunk_bits - 1) / chunk_bits;
+		if (count < size_) {
+			fill_bits(count, std::min(size_, chunksCount * chunk_bits), false);
+			chunks_.resize(chunksCount);
+			owned_.resize(chunksCount);
+		}
+		else {
+			while (chunks_.size() < chunksCount) append_chunk();
+			if (value) fill_bits(size_, count, true);
+		}
+		size_ = count;
+	}
+	void resize(size_type count) { resize(count, false); }
+
+	void clear() { chunks_.clear(); owned_.clear(); size_ = 0; }
+
+	// makes current state visible to readers, costs O(number of chunks)
+	void publish()
+	{
+		auto next = std::make_shared<version>();
+		next->chunks.assign(chunks_.cbegin(), chunks_.cend());
+		next->size = size_;
+		retired_.reserve(retired_.size() + 1);
+
+		published_.store(next.get());
+		retired_.push_back({ std::exchange(current_, std::move(next)), epoch_.load(std::memory_order_relaxed) });
+		std::fill(owned_.begin(), owned_.end(), false);
+		reclaim();
+	}
+
+	// reader side, safe to call concurrently with the writer
+	snapshot_type snapshot() const
+	{
+		for (;;) {
+			const auto epoch = epoch_.load();
+			auto& readers = readers_[epoch % 2];
+			readers.fetch_add(1);
+			if (epoch_.load() == epoch) {
+				// while counted the version cannot be freed, so its reference count is safe to increase
+				auto result = published_.load()->shared_from_this();
+				readers.fetch_sub(1);
+				return snapshot_type{ std::move(result) };
+			}
+			readers.fetch_sub(1);
+		}
+	}
+
+private: // reference implementation
+	class reference_impl {
+		friend class cow_bits_array;
+	private:
+		explicit reference_impl(cow_bits_array& context, size_type index)
+			: context_{ &context }, index_{ index } {}
+	public:
+		reference_impl(const reference_impl&) = default;
+
+		reference_impl& operator=(bool value)
+		{
+			context_->set(index_, value);
+			return *this;
+		}
+		reference_impl& operator=(const reference_impl& other) { return *this = bool(other); }
+		operator bool() const { assert(context_ != nullptr); return context_->get(index_); }
+		friend void swap(reference_impl left, reference_impl right)
+		{
+			const bool tmp = bool(left);
+			left = bool(right);
+			right = tmp;
+		}
+
+	private:
+		cow_bits_array* context_ = nullptr;
+		size_type index_ = 0;
+	};
+
+private: // snapshot implementation
+	class snapshot_impl {
+		friend class cow_bits_array;
+
+		class const_iterator_impl;
+
+		explicit snapshot_impl(std::shared_ptr<const version> ver) : version_{ std::move(ver) } {}
+
+	public:
+		using value_type = bool;
+		using size_type = cow_bits_array::size_type;
+		using difference_type = cow_bits_array::difference_type;
+		using const_reference = bool;
+		using const_iterator = const_iterator_impl;
+		using iterator = const_iterator;
+
+		bool operator[](size_type index) const { return version_->get(index); }
+		bool at(size_type index) const
+		{
+			if (index >= size()) throw std::out_of_range{ "index is out of range" };
+			return (*this)[index];
+		}
+		bool empty() const { return size() == 0; }
+		size_type size() const { return version_->size; }
+
+		// number of set bits
+		size_type count() const
+		{
+			size_type result = 0;
+			for (const auto& ch : version_->chunks) {
+				for (const auto word : ch->words) result += count_set_bits(word);
+			}
+			return result;
+		}
+
+		const_iterator cbegin() const { return const_iterator{ *version_, 0 }; }
+		const_iterator cend() const { return const_iterator{ *version_, size() }; }
+
+		const_iterator begin() const { return cbegin(); }
+		const_iterator end() const { return cend(); }
+
+	private:
+		class const_iterator_impl {
+			friend class snapshot_impl;
+
+			explicit const_iterator_impl(const version& context, size_type index)
+				: context_{ &context }, index_{ static_cast<difference_type>(index) } {}
+
+		public:
+			using iterator_concept = std::random_access_iterator_tag;
+			using iterator_category = std::random_access_iterator_tag;
+			using value_type = bool;
+			using difference_type = cow_bits_array::difference_type;
+			using pointer = void;
+			using reference = bool;
+
+			const_iterator_impl() = default;
+
+			const_iterator_impl& operator++() { ++index_; return *this; }
+			const_iterator_impl operator++(int) { auto result = *this; ++(*this); return result; }
+
+			const_iterator_impl& operator--() { --index_; return *this; }
+			const_iterator_impl operator--(int) { auto result = *this; --(*this); return result; }
+
+			const_iterator_impl& operator+=(difference_type shift) { index_ += shift; return *this; }
+			const_iterator_impl operator+(difference_type shift) const { auto result = *this; result += shift; return result; }
+			friend const_iterator_impl operator+(difference_type shift, const_iterator_impl it) { return it + shift; }
+
+			const_iterator_impl& operator-=(difference_type shift) { index_ -= shift; return *this; }
+			const_iterator_impl operator-(difference_type shift) const { auto result = *this; result -= shift; return result; }
+
+			difference_type operator-(const_iterator_impl other) const { return index_ - other.index_; }
+
+			bool operator*() const { assert(context_ != nullptr); return context_->get(static_cast<size_type>(index_)); }
+			bool operator[](difference_type n) const { return *(*this + n); }
+
+			bool operator<(const_iterator_impl other) const { return (*this - other) < 0; }
+			bool operator>(const_iterator_impl other) const { return (*this - other) > 0; }
+
+			bool operator==(const_iterator_impl other) const { return (*this - other) == 0; }
+			bool operator!=(const_iterator_impl other) const { return !(*this == other); }
+
+			bool operator<=(const_iterator_impl other) const { return !(*this > other); }
+			bool operator>=(const_iterator_impl other) const { return !(*this < other); }
+
+		private:
+			// iterators refer to the version, so they stay valid while it is published or any snapshot of it exists
+			const version* context_ = nullptr;
+			difference_type index_ = 0;
+		};
+
+	private:
+		std::shared_ptr<const version> version_;
+	};
+
+private:
+	// one lookup for the writer chunks and the published ones
+	template<class Chunks>
+	static bool get_bit(const Chunks& chunks, size_type index)
+	{
+		return (chunks[index / chunk_bits]->words[(index % chunk_bits) / word_bits] & bit_mask<word_type>(index % word_bits)) != 0;
+	}
+
+	void append_chunk()
+	{
+		chunks_.push_back(std::make_shared<chunk>());
+		owned_.push_back(true);
+	}
+
+	// clones chunk if it is shared with published version
+	chunk& mutable_chunk(size_type chunkIndex)
+	{
+		if (!owned_[chunkIndex]) {
+			chunks_[chunkIndex] = std::make_shared<chunk>(*chunks_[chunkIndex]);
+			owned_[chunkIndex] = true;
+		}
+		return *chunks_[chunkIndex];
+	}
+
+	bool get(size_type index) const
+	{
+		assert(index < size_);
+		return get_bit(chunks_, index);
+	}
+
+	void set(size_type index, bool value)
+	{
+		assert(index < size_);
+		if (get(index) == value) return;
+
+		auto& word = mutable_chunk(index / chunk_bits).words[(index % chunk_bits) / word_bits];
+		word ^= bit_mask<word_type>(index % word_bits);
+	}
+
+	// versions replaced before the current epoch are freed once readers counted in both halves have left
+	void reclaim()
+	{
+		const auto epoch = epoch_.load(std::memory_order_relaxed);
+		if (readers_[(epoch + 1) % 2].load() != 0) return;
+
+		retired_.erase(std::remove_if(retired_.begin(), retired_.end(),
+			[epoch](const retired_version& retired) { return retired.epoch < epoch; }), retired_.end());
+		if (!retired_.empty()) epoch_.store(epoch + 1);
+	}
+
+	// fills chunk by chunk, so only the chunks in [first, last) are cloned
+	void fill_bits(size_type first, size_type last, bool value)
+	{
+		while (first < last) {
+			const auto chunkIndex = first / chunk_bits;
+			const auto chunkFirst = chunkIndex * chunk_bits;
+			const auto chunkLast = std::min(last, chunkFirst + chunk_bits);
+
+			::fill_bits(mutable_chunk(chunkIndex).words.data(), first - chunkFirst, chunkLast - chunkFirst, value);
+			first = chunkLast;
+		}
+	}
+
+private:
+	void check_index(size_type index) const { if (index >= size_) throw std::out_of_range{ "index is out of range" }; }
+	void empty_check() const { if (empty()) throw std::out_of_range{ "container is empty" }; }
+
+private:
+	std::vector<std::shared_ptr<chunk>> chunks_;
+	std::vector<bool> owned_;
+	size_type size_{ 0 };
+
+	std::shared_ptr<const version> current_;
+	std::vector<retired_version> retired_;
+	std::atomic<const version*> published_;
+	std::atomic<std::uint64_t> epoch_{ 0 };
+	mutable std::array<std::atomic<std::size_t>, 2> readers_{};
+};
+
+#endif // !COW_BITS_ARRAY_HPP
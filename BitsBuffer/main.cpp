@@ -1,9 +1,13 @@
 #include "bits_array.hpp"
+#include "perf_counters.hpp"
 
 #include <iostream>
 #include <vector>
 #include <algorithm>
 #include <chrono>
+#include <cstring>
+#include <utility>
+#include <atomic>
 
 template<class BitsContainer, typename = std::enable_if_t<std::is_same_v<typename BitsContainer::value_type, bool>>>
 std::ostream& operator<<(std::ostream& os, const BitsContainer& cont)
@@ -14,8 +18,144 @@ std::ostream& operator<<(std::ostream& os, const BitsContainer& cont)
 	return os;
 }
 
-int main()
+volatile std::size_t benchmark_sink = 0;
+void* volatile benchmark_pointer = nullptr;
+
+// makes the compiler assume value is read and changed outside, so kernels are not hoisted out of the loop
+template<class T>
+void clobber(T& value)
+{
+#ifdef __GNUC__
+	asm volatile("" : : "r"(&value) : "memory");
+#else
+	benchmark_pointer = &value;
+	std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+}
+
+// runs kernel many times and prints time, hardware counters and operations stats per iteration
+template<class Kernel>
+void run_kernel(const char* name, std::size_t iterations, Kernel kernel)
+{
+	perf_counters counters;
+	reset_thread_bits_stats();
+
+	const auto beginTime = std::chrono::steady_clock::now();
+	counters.start();
+	for (std::size_t i = 0; i < iterations; ++i) {
+		kernel(i);
+	}
+	const auto values = counters.stop();
+	const auto endTime = std::chrono::steady_clock::now();
+
+	const auto per_iteration = [iterations](auto value) { return static_cast<double>(value) / iterations; };
+	std::cout << name << ": " << per_iteration(std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - beginTime).count()) << " ns";
+	if (counters.available()) {
+		std::cout << ", " << per_iteration(values.cycles) << " cycles"
+			<< ", " << per_iteration(values.instructions) << " instructions"
+			<< ", " << per_iteration(values.branch_misses) << " branch-misses";
+	}
+	std::cout << std::endl;
+
+	if constexpr (bits_stats_enabled) {
+		const auto& stats = thread_bits_stats();
+		const auto print = [](const char* operation, const bits_operation_stats& op) {
+			if (op.calls != 0) std::cout << "    " << operation << ": " << op.calls << " calls, " << op.shifted_bits << " shifted bits" << std::endl;
+		};
+		print("insert", stats.insert);
+		print("erase", stats.erase);
+		print("resize", stats.resize);
+		print("proxy write", stats.proxy_write);
+		print("failed check", stats.failed_check);
+	}
+}
+
+void run_benchmarks()
 {
+	constexpr std::size_t iterations = 1000000;
+	if (!perf_counters{}.available()) std::cout << "hardware counters are not available" << std::endl;
+	if constexpr (!bits_stats_enabled) std::cout << "operations stats are disabled, build with BITS_ENABLE_STATS (msbuild /p:BitsStats=true)" << std::endl;
+
+	bits_array<std::uint64_t> arr;
+	run_kernel("insert", iterations, [&](std::size_t i) {
+		if (arr.size() == arr.max_size) arr.resize(arr.max_size / 2);
+		arr.insert(arr.cbegin() + arr.size() / 2, 1, i & 1);
+	});
+	benchmark_sink = arr.size();
+
+	run_kernel("erase", iterations, [&](std::size_t) {
+		if (arr.size() < 2) arr.resize(arr.max_size, true);
+		arr.erase(arr.cbegin() + arr.size() / 2);
+	});
+	benchmark_sink = arr.size();
+
+	run_kernel("resize", iterations, [&](std::size_t i) { arr.resize(i % arr.max_size, i & 1); });
+	benchmark_sink = arr.size();
+
+	arr.resize(arr.max_size);
+	run_kernel("proxy write", iterations, [&](std::size_t i) { arr[i % arr.max_size] = (i & 3) == 0; });
+	benchmark_sink = std::count(arr.cbegin(), arr.cend(), true);
+
+	// the same loops through indices, which is how the previous iterators accessed bits,
+	// through iterators, over std::vector<bool> and with word-level members
+	std::vector<bool> vec(arr.max_size);
+	const auto generate = [](auto first, auto last, std::size_t i) {
+		std::generate(first, last, [flag = (i & 1) != 0]() mutable { flag = !flag; return flag; });
+	};
+	const auto invert = [](bool bit) { return !bit; };
+
+	run_kernel("generate, index", iterations, [&](std::size_t i) {
+		auto flag = (i & 1) != 0;
+		for (std::size_t j = 0; j < arr.size(); ++j) arr[j] = (flag = !flag);
+		clobber(arr);
+	});
+	run_kernel("generate, iterators", iterations, [&](std::size_t i) { generate(std::begin(arr), std::end(arr), i); clobber(arr); });
+	run_kernel("generate, std::vector<bool>", iterations, [&](std::size_t i) { generate(std::begin(vec), std::end(vec), i); clobber(vec); });
+
+	run_kernel("transform, index", iterations, [&](std::size_t) {
+		for (std::size_t j = 0; j < arr.size(); ++j) arr[j] = invert(std::as_const(arr)[j]);
+		clobber(arr);
+	});
+	run_kernel("transform, iterators", iterations, [&](std::size_t) {
+		std::transform(std::cbegin(arr), std::cend(arr), std::begin(arr), invert);
+		clobber(arr);
+	});
+	run_kernel("transform, std::vector<bool>", iterations, [&](std::size_t) {
+		std::transform(std::cbegin(vec), std::cend(vec), std::begin(vec), invert);
+		clobber(vec);
+	});
+	run_kernel("transform, flip()", iterations, [&](std::size_t) { arr.flip(); clobber(arr); });
+
+	run_kernel("count, index", iterations, [&](std::size_t) {
+		clobber(arr);
+		std::size_t result = 0;
+		for (std::size_t j = 0; j < arr.size(); ++j) result += std::as_const(arr)[j];
+		benchmark_sink = result;
+	});
+	run_kernel("count, iterators", iterations, [&](std::size_t) {
+		clobber(arr);
+		benchmark_sink = std::count(std::cbegin(arr), std::cend(arr), true);
+	});
+	run_kernel("count, std::vector<bool>", iterations, [&](std::size_t) {
+		clobber(vec);
+		benchmark_sink = std::count(std::cbegin(vec), std::cend(vec), true);
+	});
+	run_kernel("count, count()", iterations, [&](std::size_t) { clobber(arr); benchmark_sink = arr.count(); });
+
+	run_kernel("generate and sort", iterations / 100, [&](std::size_t) {
+		std::generate(std::begin(arr), std::end(arr), [flag = false]() mutable { flag = !flag; return flag; });
+		std::sort(std::begin(arr), std::end(arr));
+	});
+	benchmark_sink = arr.front();
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc > 1 && std::strcmp(argv[1], "--bench") == 0) {
+		run_benchmarks();
+		return 0;
+	}
+
 	const auto generator = [] { static bool flag = 0; flag = !flag; return flag; };
 
 	constexpr auto defaultSize = 32;
@@ -0,0 +1,105 @@
+#pragma once
+#ifndef PERF_COUNTERS_HPP
+#define PERF_COUNTERS_HPP
+
+#include <cstdint>
+#include <array>
+
+#ifdef __linux__
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+struct perf_counters_values {
+	std::uint64_t cycles = 0;
+	std::uint64_t instructions = 0;
+	std::uint64_t branch_misses = 0;
+};
+
+// Hardware counters of the calling thread read through Linux perf_event_open.
+// On other systems, or when the kernel denies access, available() is false and all values are zero.
+class perf_counters {
+public:
+	explicit perf_counters()
+	{
+#ifdef __linux__
+		constexpr std::array<std::uint64_t, events_count> events = {
+			PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_BRANCH_MISSES
+		};
+
+		for (std::size_t i = 0; i < events_count; ++i) {
+			perf_event_attr attr;
+			std::memset(&attr, 0, sizeof(attr));
+			attr.size = sizeof(attr);
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.config = events[i];
+			attr.disabled = (i == 0);
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			attr.read_format = PERF_FORMAT_GROUP;
+
+			fds_[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, fds_[0], 0));
+			if (fds_[i] < 0) {
+				close_all();
+				return;
+			}
+		}
+#endif
+	}
+
+	perf_counters(const perf_counters&) = delete;
+	perf_counters& operator=(const perf_counters&) = delete;
+
+	~perf_counters() { close_all(); }
+
+	bool available() const { return fds_[0] >= 0; }
+
+	void start()
+	{
+#ifdef __linux__
+		if (!available()) return;
+		ioctl(fds_[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+		ioctl(fds_[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+	}
+
+	perf_counters_values stop()
+	{
+		perf_counters_values result;
+#ifdef __linux__
+		if (!available()) return result;
+		ioctl(fds_[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+		// PERF_FORMAT_GROUP layout: number of events followed by their values
+		std::array<std::uint64_t, events_count + 1> data{};
+		if (read(fds_[0], data.data(), sizeof(data)) != static_cast<ssize_t>(sizeof(data))) return result;
+
+		result.cycles = data[1];
+		result.instructions = data[2];
+		result.branch_misses = data[3];
+#endif
+		return result;
+	}
+
+private:
+	void close_all()
+	{
+#ifdef __linux__
+		for (auto& fd : fds_) {
+			if (fd >= 0) close(fd);
+			fd = -1;
+		}
+#endif
+	}
+
+private:
+	static constexpr std::size_t events_count = 3;
+
+	std::array<int, events_count> fds_{ -1, -1, -1 };
+};
+
+#endif // !PERF_COUNTERS_HPP
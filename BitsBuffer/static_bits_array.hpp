@@ -0,0 +1,355 @@
+#pragma once
+#ifndef STATIC_BITS_ARRAY_HPP
+#define STATIC_BITS_ARRAY_HPP
+
+#include "bits_utils.hpp"
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <algorithm>
+#include <type_traits>
+#include <stdexcept>
+#include <iterator>
+#include <cassert>
+
+
+// Fixed capacity bits container for N greater than one machine word.
+// Bits are kept inline in an array of words, so the container never allocates
+// and is trivially copyable.
+template<std::size_t N>
+class static_bits_array {
+	static_assert(N > 0, "capacity must be positive");
+
+	class reference_impl;
+
+	class iterator_impl;
+	class const_iterator_impl;
+
+	friend class iterator_impl;
+	friend class const_iterator_impl;
+
+	template<class> friend struct bits_words_access;
+
+	using word_type = std::uint64_t;
+
+	static constexpr std::size_t word_bits = 8 * sizeof(word_type);
+	static constexpr std::size_t words_count = (N + word_bits - 1) / word_bits;
+
+public:
+	using value_type = bool;
+	using size_type = smallest_unsigned_type<std::bit_width(N)>;
+	using difference_type = std::ptrdiff_t;
+	using reference = reference_impl;
+	using const_reference = bool;
+
+	using iterator = iterator_impl;
+	using const_iterator = const_iterator_impl;
+	using reverse_iterator = std::reverse_iterator<iterator>;
+	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+public:
+	static constexpr auto max_size = N;
+
+	explicit constexpr static_bits_array() = default;
+	explicit constexpr static_bits_array(std::size_t sz) : static_bits_array(sz, false) {}
+	explicit constexpr static_bits_array(std::size_t sz, bool val)
+	{
+		check_overflow(sz);
+		size_ = static_cast<size_type>(sz);
+		if (val) fill_bits(0, sz, true);
+	}
+
+	template<class It, typename = has_iterator_type<It>>
+	explicit constexpr static_bits_array(It first, It last) { std::copy(first, last, std::back_inserter(*this)); }
+
+	constexpr reference operator[](std::size_t index) { return reference{ words_[index / word_bits], bit_mask<word_type>(index % word_bits) }; }
+	constexpr bool operator[](std::size_t index) const { return get_bit(words_[index / word_bits], index % word_bits); }
+	constexpr reference at(std::size_t index) { check_index(index); return (*this)[index]; }
+	constexpr bool at(std::size_t index) const { check_index(index); return (*this)[index]; }
+	constexpr bool empty() const { return size_ == 0; }
+
+	constexpr reference front() { empty_check(); return *(begin()); }
+	constexpr bool front() const { empty_check(); return *(cbegin()); }
+
+	constexpr reference back() { empty_check(); return *(end() - 1); }
+	constexpr bool back() const { empty_check(); return *(cend() - 1); }
+
+	constexpr iterator insert(const_iterator it, std::size_t count, bool value)
+	{
+		check_iterator(it);
+
+		const auto new_size = size_ + count;
+		check_overflow(new_size);
+
+		const auto index = static_cast<std::size_t>(it - cbegin());
+		shift_tail_right(index, count);
+		if (value) fill_bits(index, index + count, true);
+		size_ = static_cast<size_type>(new_size);
+		return iterator{ *this, index };
+	}
+	constexpr iterator insert(const_iterator it, bool value) { return insert(it, 1, value); }
+	template<typename InputIt, typename = has_iterator_type<InputIt>>
+	constexpr iterator insert(const_iterator it, InputIt first, InputIt last)
+	{
+		check_iterator(it);
+
+		const auto itIndex = it - cbegin();
+		for (; first != last; ++first, ++it) {
+			insert(it, 1, bool(*first));
+		}
+		return iterator{ *this, static_cast<std::size_t>(itIndex) };
+	}
+
+	constexpr iterator erase(const_iterator first, const_iterator last)
+	{
+		check_iterators_range(first, last);
+
+		const auto indexFirst = static_cast<std::size_t>(first - cbegin());
+		const auto count = static_cast<std::size_t>(last - first);
+		if (count == 0) {
+			return iterator{ *this, indexFirst };
+		}
+
+		shift_tail_left(indexFirst, count);
+		size_ = static_cast<size_type>(size_ - count);
+		return iterator{ *this, indexFirst };
+	}
+	constexpr iterator erase(const_iterator it)
+	{
+		if (it < cbegin() || it >= cend()) throw std::out_of_range{ "iterator is out of range" };
+		return erase(it, it + 1);
+	}
+
+	constexpr void push_back(bool value)
+	{
+		check_overflow(size_ + std::size_t{ 1 });
+		const std::size_t index = size_++;
+		if (value) words_[index / word_bits] |= bit_mask<word_type>(index % word_bits);
+	}
+	constexpr void pop_back() { empty_check(); erase(cend() - 1); }
+
+	constexpr void resize(std::size_t count, bool value)
+	{
+		if (size_ == count) return;
+		check_overflow(count);
+
+		if (size_ > count) fill_bits(count, size_, false);
+		else if (value) fill_bits(size_, count, true);
+
+		size_ = static_cast<size_type>(count);
+	}
+	constexpr void resize(std::size_t count) { resize(count, false); }
+
+	constexpr size_type size() const { return size_; }
+	constexpr void clear() { words_.fill(0); size_ = 0; }
+
+	constexpr iterator begin() { return iterator{ *this, 0 }; }
+	constexpr iterator end() { return iterator{ *this, size_ }; }
+
+	constexpr const_iterator cbegin() const { return const_iterator{ *this, 0 }; }
+	constexpr const_iterator cend() const { return const_iterator{ *this, size_ }; }
+
+	constexpr const_iterator begin() const { return cbegin(); }
+	constexpr const_iterator end() const { return cend(); }
+
+private: // reference implementation
+	class reference_impl {
+		friend class static_bits_array;
+		friend class iterator_impl;
+	private:
+		explicit constexpr reference_impl(word_type& word, word_type mask)
+			: word_{ &word }, mask_{ mask } {}
+	public:
+		constexpr reference_impl(const reference_impl&) = default;
+
+		// const as proxy writes through const references are required by std::indirectly_writable
+		constexpr const reference_impl& operator=(bool value) const
+		{
+			*word_ = value ? (*word_ | mask_) : (*word_ & ~mask_);
+			return *this;
+		}
+		constexpr reference_impl& operator=(const reference_impl& other) { *this = bool(other); return *this; }
+		constexpr operator bool() const { assert(word_ != nullptr); return (*word_ & mask_) != 0; }
+		constexpr friend void swap(reference_impl left, reference_impl right)
+		{
+			const bool tmp = bool(left);
+			left = bool(right);
+			right = tmp;
+		}
+
+	private:
+		word_type* word_ = nullptr;
+		word_type mask_ = 0;
+	};
+
+private: // iterators
+	class iterator_impl {
+		friend class static_bits_array;
+		friend class const_iterator_impl;
+
+		explicit constexpr iterator_impl(static_bits_array& context, std::size_t index)
+			: context_{ &context }, index_{ static_cast<difference_type>(index) } {}
+
+	public:
+		using iterator_concept = std::random_access_iterator_tag;
+		using iterator_category = std::random_access_iterator_tag;
+		using value_type = bool;
+		using difference_type = static_bits_array::difference_type;
+		using pointer = void;
+		using reference = reference_impl;
+
+		constexpr iterator_impl() = default;
+
+		constexpr iterator_impl& operator++() { ++index_; return *this; }
+		constexpr iterator_impl operator++(int) { auto result = *this; ++(*this); return result; }
+
+		constexpr iterator_impl& operator--() { --index_; return *this; }
+		constexpr iterator_impl operator--(int) { auto result = *this; --(*this); return result; }
+
+		constexpr iterator_impl& operator+=(difference_type shift) { index_ += shift; return *this; }
+		constexpr iterator_impl operator+(difference_type shift) const { auto result = *this; result += shift; return result; }
+		friend constexpr iterator_impl operator+(difference_type shift, iterator_impl it) { return it + shift; }
+
+		constexpr iterator_impl& operator-=(difference_type shift) { index_ -= shift; return *this; }
+		constexpr iterator_impl operator-(difference_type shift) const { auto result = *this; result -= shift; return result; }
+
+		constexpr difference_type operator-(iterator_impl other) const { return index_ - other.index_; }
+
+		constexpr reference_impl operator*() const
+		{
+			assert(context_ != nullptr);
+			assert((index_ >= 0 && index_ < context_->size_));
+			return (*context_)[static_cast<std::size_t>(index_)];
+		}
+		constexpr reference_impl operator[](difference_type n) const { return *(*this + n); }
+
+		constexpr bool operator<(iterator_impl other) const { return (*this - other) < 0; }
+		constexpr bool operator>(iterator_impl other) const { return (*this - other) > 0; }
+
+		constexpr bool operator==(iterator_impl other) const { return (*this - other) == 0; }
+		constexpr bool operator!=(iterator_impl other) const { return !(*this == other); }
+
+		constexpr bool operator<=(iterator_impl other) const { return !(*this > other); }
+		constexpr bool operator>=(iterator_impl other) const { return !(*this < other); }
+
+	private:
+		static_bits_array* context_ = nullptr;
+		difference_type index_ = 0;
+	};
+
+	class const_iterator_impl {
+		friend class static_bits_array;
+
+		explicit constexpr const_iterator_impl(const static_bits_array& context, std::size_t index)
+			: context_{ &context }, index_{ static_cast<difference_type>(index) } {}
+
+	public:
+		using iterator_concept = std::random_access_iterator_tag;
+		using iterator_category = std::random_access_iterator_tag;
+		using value_type = bool;
+		using difference_type = static_bits_array::difference_type;
+		using pointer = void;
+		using reference = bool;
+
+		constexpr const_iterator_impl() = default;
+		constexpr const_iterator_impl(const iterator_impl& other)
+			: context_{ other.context_ }, index_{ other.index_ } {}
+
+		constexpr const_iterator_impl& operator++() { ++index_; return *this; }
+		constexpr const_iterator_impl operator++(int) { auto result = *this; ++(*this); return result; }
+
+		constexpr const_iterator_impl& operator--() { --index_; return *this; }
+		constexpr const_iterator_impl operator--(int) { auto result = *this; --(*this); return result; }
+
+		constexpr const_iterator_impl& operator+=(difference_type shift) { index_ += shift; return *this; }
+		constexpr const_iterator_impl operator+(difference_type shift) const { auto result = *this; result += shift; return result; }
+		friend constexpr const_iterator_impl operator+(difference_type shift, const_iterator_impl it) { return it + shift; }
+
+		constexpr const_iterator_impl& operator-=(difference_type shift) { index_ -= shift; return *this; }
+		constexpr const_iterator_impl operator-(difference_type shift) const { auto result = *this; result -= shift; return result; }
+
+		constexpr difference_type operator-(const_iterator_impl other) const { return index_ - other.index_; }
+
+		constexpr bool operator*() const
+		{
+			assert(context_ != nullptr);
+			assert((index_ >= 0 && index_ < context_->size_));
+			return (*context_)[static_cast<std::size_t>(index_)];
+		}
+		constexpr bool operator[](difference_type n) const { return *(*this + n); }
+
+		constexpr bool operator<(const_iterator_impl other) const { return (*this - other) < 0; }
+		constexpr bool operator>(const_iterator_impl other) const { return (*this - other) > 0; }
+
+		constexpr bool operator==(const_iterator_impl other) const { return (*this - other) == 0; }
+		constexpr bool operator!=(const_iterator_impl other) const { return !(*this == other); }
+
+		constexpr bool operator<=(const_iterator_impl other) const { return !(*this > other); }
+		constexpr bool operator>=(const_iterator_impl other) const { return !(*this < other); }
+
+	private:
+		const static_bits_array* context_ = nullptr;
+		difference_type index_ = 0;
+	};
+
+private: // cross-word operations
+	// moves bits [index, size) to [index + count, size + count), bits [index, index + count) become zero
+	constexpr void shift_tail_right(std::size_t index, std::size_t count)
+	{
+		if (count == 0 || index == size_) return;
+
+		const auto firstWord = index / word_bits;
+		const auto lastWord = (size_ + count - 1) / word_bits;
+		const auto wordShift = count / word_bits;
+		const auto bitShift = count % word_bits;
+		const auto head = high_bits_mask<word_type>(index % word_bits);
+
+		const auto source = [&](std::size_t i) -> word_type {
+			if (i < firstWord) return 0;
+			return (i == firstWord) ? (words_[i] & ~head) : words_[i];
+		};
+
+		for (auto i = lastWord + 1; i-- > firstWord;) {
+			const auto cur = (i >= wordShift) ? source(i - wordShift) : word_type{ 0 };
+			const auto prev = (i >= wordShift + 1) ? source(i - wordShift - 1) : word_type{ 0 };
+			const auto shifted = funnel_shift_left(prev, cur, word_bits - bitShift);
+			words_[i] = (i == firstWord) ? ((words_[i] & head) | shifted) : shifted;
+		}
+	}
+
+	// moves bits [index + count, size) to [index, size - count), bits after size - count become zero
+	constexpr void shift_tail_left(std::size_t index, std::size_t count)
+	{
+		const auto firstWord = index / word_bits;
+		const auto lastWord = (size_ - 1) / word_bits;
+		const auto wordShift = count / word_bits;
+		const auto bitShift = count % word_bits;
+		const auto head = high_bits_mask<word_type>(index % word_bits);
+
+		for (auto i = firstWord; i <= lastWord; ++i) {
+			const auto cur = (i + wordShift < words_count) ? words_[i + wordShift] : word_type{ 0 };
+			const auto next = (i + wordShift + 1 < words_count) ? words_[i + wordShift + 1] : word_type{ 0 };
+			const auto shifted = funnel_shift_left(cur, next, bitShift);
+			words_[i] = (i == firstWord) ? ((words_[i] & head) | (shifted & ~head)) : shifted;
+		}
+	}
+
+	constexpr void fill_bits(std::size_t first, std::size_t last, bool value) { ::fill_bits(words_.data(), first, last, value); }
+
+private:
+	constexpr void check_index(std::size_t index) const { if (index >= size_) throw std::out_of_range{ "index is out of range" }; }
+	constexpr void check_overflow(std::size_t sz) const { if (sz > max_size) throw std::overflow_error{ "size is greater than maximum allowed" }; }
+	constexpr void empty_check() const { if (empty()) throw std::out_of_range{ "container is empty" }; }
+	constexpr void check_iterator(const_iterator it) const { if (it < cbegin() || it > cend()) throw std::out_of_range{ "iterator is out of range" }; }
+	constexpr void check_iterators_range(const_iterator first, const_iterator last) const
+	{
+		if (first > last || first < cbegin() || last > cend()) throw std::out_of_range{ "invalid iterators range" };
+	}
+
+private:
+	std::array<word_type, words_count> words_{};
+	size_type size_{ 0 };
+};
+
+#endif // !STATIC_BITS_ARRAY_HPP
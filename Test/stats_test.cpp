@@ -0,0 +1,39 @@
+#include "pch.h"
+
+// the containers in this file are instrumented, the rest of the tests use the default build
+#define BITS_ENABLE_STATS
+#include "..//BitsBuffer/bits_array.hpp"
+
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+
+TEST(Stats, BitsArrayOperations) {
+	static_assert(bits_stats_enabled);
+	reset_thread_bits_stats();
+
+	bits_array<std::uint32_t> actual(10, true);
+	actual.insert(actual.cbegin() + 4, 3, false);
+	actual.erase(actual.cbegin() + 2, actual.cbegin() + 5);
+	actual.erase(actual.cbegin());
+	actual.resize(20);
+	actual[3] = true;
+	actual.front() = false;
+	EXPECT_THROW(actual.at(20), std::out_of_range);
+	EXPECT_THROW(actual.insert(actual.cbegin(), 13, true), std::overflow_error);
+
+	const auto& stats = thread_bits_stats();
+	EXPECT_EQ(stats.insert.calls, 1);
+	EXPECT_EQ(stats.insert.shifted_bits, 6);
+	EXPECT_EQ(stats.erase.calls, 2);
+	EXPECT_EQ(stats.erase.shifted_bits, 8 + 9);
+	EXPECT_EQ(stats.resize.calls, 1);
+	EXPECT_EQ(stats.proxy_write.calls, 2);
+	EXPECT_EQ(stats.failed_check.calls, 2);
+
+	// counters are per thread
+	std::thread{ [] { EXPECT_EQ(thread_bits_stats().insert.calls, 0); } }.join();
+
+	reset_thread_bits_stats();
+	EXPECT_EQ(thread_bits_stats().insert.calls, 0);
+}
\ No newline at end of file
@@ -1,9 +1,17 @@
 #include "pch.h"
+
 #include "..//BitsBuffer/bits_array.hpp"
+#include "..//BitsBuffer/bits_tree.hpp"
+#include "..//BitsBuffer/cow_bits_array.hpp"
+#include "..//BitsBuffer/static_bits_array.hpp"
+#include "..//BitsBuffer/bits_convert.hpp"
 
 #include <vector>
 #include <iostream>
 #include <algorithm>
+#include <random>
+#include <thread>
+#include <atomic>
 
 // #define PRINT_VALUES
 
@@ -271,6 +279,60 @@ TEST(Resize, Trivial) {
 	check_resize(expected, actual, expected.size() + 3, 0);
 }
 
+constexpr auto make_alternating_bits()
+{
+	bits_array<std::uint16_t> result(10, true);
+	for (std::size_t i = 0; i < result.size(); i += 2) result[i] = false;
+	result.insert(result.cbegin() + 3, 2, true);
+	result.erase(result.cbegin());
+	return result;
+}
+
+TEST(ConstantEvaluation, BitsArray) {
+	constexpr auto arr = make_alternating_bits();
+	static_assert(arr.size() == 11);
+	static_assert(arr[0] && !arr[1] && arr[2] && arr[3] && arr[4] && arr.back());
+
+	constexpr auto lit = "1011"_bits;
+	static_assert(std::is_same_v<std::remove_const_t<decltype(lit)>, bits_array<std::uint8_t>>);
+	static_assert(lit.size() == 4 && lit[0] && !lit[1] && lit[2] && lit[3]);
+	static_assert(std::is_same_v<decltype("10110110101"_bits), bits_array<std::uint16_t>>);
+
+	constexpr auto mask = make_bits_array<std::uint64_t>("111000111");
+	static_assert(mask.size() == 9 && mask.front() && !mask[3] && mask.back());
+
+	const std::vector<bool> expected = { 1, 0, 1, 1, 1, 0, 1, 0, 1, 0, 1 };
+	check_containers_equality(expected, arr);
+}
+
+TEST(ConstantEvaluation, CompileTimePositions) {
+	static_assert(insert_bits<0, 2>(std::uint8_t{ 0b1010'0000 }, true) == 0b1110'1000);
+	static_assert(insert_bits<3, 1>(std::uint8_t{ 0b1111'1111 }, false) == 0b1110'1111);
+	static_assert(erase_bits<1, 2>(std::uint8_t{ 0b1011'0110 }) == 0b1101'1000);
+	static_assert(get_bit<7>(std::uint8_t{ 1 }) && !get_bit<0>(std::uint8_t{ 1 }));
+	static_assert(set_bit<63>(std::uint64_t{ 0 }, true) == 1);
+
+	std::mt19937 gen{ 3 };
+	for (int i = 0; i < 1000; ++i) {
+		const auto bits = static_cast<std::uint32_t>(gen());
+		EXPECT_EQ((insert_bits<5, 7>(bits, true)), insert_bits(bits, 5, 7, true));
+		EXPECT_EQ((insert_bits<0, 32>(bits, false)), insert_bits(bits, 0, 32, false));
+		EXPECT_EQ((erase_bits<9, 4>(bits)), erase_bits(bits, 9, 4));
+		EXPECT_EQ((erase_bits<0, 32>(bits)), erase_bits(bits, 0, 32));
+	}
+
+	std::vector<bool> expected = { 1, 0, 1, 1 };
+	auto actual = "1011"_bits;
+	expected.insert(expected.cbegin() + 2, 3, false);
+	actual.insert<2, 3>(false);
+	check_containers_equality(expected, actual);
+
+	expected.erase(expected.cbegin() + 1, expected.cbegin() + 3);
+	actual.erase<1, 2>();
+	check_containers_equality(expected, actual);
+	EXPECT_THROW((actual.insert<7, 1>(true)), std::out_of_range);
+}
+
 TEST(Iterators, STLalgorithms) {
 	std::vector<bool> expected;
 	bits_array<std::uint32_t> actual;
@@ -285,4 +347,433 @@ TEST(Iterators, STLalgorithms) {
 	std::reverse(expected.begin(), expected.end());
 	std::reverse(actual.begin(), actual.end());
 	check_containers_equality(expected, actual);
-}
\ No newline at end of file
+}
+
+TEST(Iterators, Ranges) {
+	using array_type = bits_array<std::uint64_t>;
+	static_assert(std::random_access_iterator<array_type::iterator>);
+	static_assert(std::random_access_iterator<array_type::const_iterator>);
+	static_assert(std::ranges::random_access_range<array_type>);
+
+	std::vector<bool> expected;
+	array_type actual;
+
+	std::mt19937 gen{ 7 };
+	std::bernoulli_distribution dist;
+	std::ranges::generate_n(std::back_inserter(expected), 60, [&] { return dist(gen); });
+	actual.resize(expected.size());
+	std::ranges::copy(expected, actual.begin());
+	check_containers_equality(expected, actual);
+
+	EXPECT_EQ(std::ranges::count(actual, true), std::ranges::count(expected, true));
+	EXPECT_EQ(actual.count(), std::ranges::count(expected, true));
+
+	// walking backwards from end crosses the past the end position
+	auto it = actual.end();
+	for (auto expectedIt = expected.end(); expectedIt != expected.begin();)
+		EXPECT_EQ(*(--it), *(--expectedIt));
+
+	std::ranges::transform(actual, actual.begin(), [](bool value) { return !value; });
+	std::transform(expected.begin(), expected.end(), expected.begin(), [](bool value) { return !value; });
+	check_containers_equality(expected, actual);
+
+	actual.flip();
+	expected.flip();
+	check_containers_equality(expected, actual);
+
+	// assigning one proxy to another copies the value
+	std::sort(expected.begin(), expected.end());
+	std::sort(actual.begin(), actual.end());
+	check_containers_equality(expected, actual);
+
+	std::ranges::sort(actual, std::greater<>{});
+	std::sort(expected.begin(), expected.end(), std::greater<>{});
+	check_containers_equality(expected, actual);
+}
+
+TEST(Iterators, OutOfRangeOnFullArray) {
+	using array_type = bits_array<std::uint64_t>;
+
+	// on a full array the past the end position shares its mask with no other position
+	array_type actual(array_type::max_size, 1);
+	EXPECT_THROW(actual.cbegin() - 1, std::out_of_range);
+	EXPECT_THROW(actual.cend() + 3, std::out_of_range);
+	EXPECT_THROW(--actual.begin(), std::out_of_range);
+	EXPECT_THROW(actual.erase(actual.cbegin() + 60, actual.cend() + 3), std::out_of_range);
+	EXPECT_EQ(actual.size(), array_type::max_size);
+
+	EXPECT_EQ(actual.cend() - actual.cbegin(), static_cast<std::ptrdiff_t>(array_type::max_size));
+	EXPECT_TRUE(--actual.cend() == actual.cbegin() + (array_type::max_size - 1));
+	EXPECT_TRUE(actual.erase(actual.cbegin() + 60, actual.cend()) == actual.cend());
+	EXPECT_EQ(actual.size(), 60u);
+}
+
+TEST(BitsTree, InsertErase) {
+	std::vector<bool> expected;
+	bits_tree actual;
+
+	std::mt19937 gen{ 42 };
+	for (int i = 0; i < 20000; ++i) {
+		const auto index = std::uniform_int_distribution<std::size_t>{ 0, expected.size() }(gen);
+		const bool value = gen() & 1;
+		expected.insert(expected.cbegin() + index, value);
+		actual.insert(actual.cbegin() + index, value);
+	}
+	check_containers_equality(expected, actual);
+
+	for (int i = 0; i < 15000; ++i) {
+		const auto index = std::uniform_int_distribution<std::size_t>{ 0, expected.size() - 1 }(gen);
+		expected.erase(expected.cbegin() + index);
+		actual.erase(actual.cbegin() + index);
+	}
+	check_containers_equality(expected, actual);
+
+	const auto shift = expected.size() / 3;
+	expected.erase(expected.cbegin() + shift, expected.cend() - shift);
+	actual.erase(actual.cbegin() + shift, actual.cend() - shift);
+	check_containers_equality(expected, actual);
+
+	expected.insert(expected.cbegin() + shift, 3000, 1);
+	actual.insert(actual.cbegin() + shift, 3000, 1);
+	check_containers_equality(expected, actual);
+}
+
+TEST(BitsTree, BulkOperations) {
+	std::vector<bool> expected(100000, true);
+	bits_tree actual(100000, true);
+	check_containers_equality(expected, actual);
+
+	std::mt19937 gen{ 11 };
+	for (int i = 0; i < 200; ++i) {
+		const auto index = std::uniform_int_distribution<std::size_t>{ 0, expected.size() }(gen);
+		if (gen() % 2 == 0) {
+			const auto count = std::uniform_int_distribution<std::size_t>{ 0, 5000 }(gen);
+			const bool value = gen() & 1;
+			expected.insert(expected.cbegin() + index, count, value);
+			actual.insert(actual.cbegin() + index, count, value);
+		}
+		else {
+			const auto count = std::uniform_int_distribution<std::size_t>{ 0, expected.size() - index }(gen) / 4;
+			expected.erase(expected.cbegin() + index, expected.cbegin() + index + count);
+			actual.erase(actual.cbegin() + index, actual.cbegin() + index + count);
+		}
+	}
+	check_containers_equality(expected, actual);
+	EXPECT_EQ(actual.count(), static_cast<std::size_t>(std::count(expected.begin(), expected.end(), true)));
+
+	std::vector<bool> pattern;
+	for (int i = 0; i < 2000; ++i) pattern.push_back(gen() % 3 == 0);
+	expected.insert(expected.cbegin() + 7, pattern.begin(), pattern.end());
+	actual.insert(actual.cbegin() + 7, pattern.begin(), pattern.end());
+	check_containers_equality(expected, actual);
+
+	expected.resize(3);
+	actual.resize(3);
+	check_containers_equality(expected, actual);
+	EXPECT_EQ(actual.rank(3), static_cast<std::size_t>(std::count(expected.begin(), expected.end(), true)));
+}
+
+TEST(BitsTree, RankSelect) {
+	std::vector<bool> expected;
+	std::mt19937 gen{ 7 };
+	for (int i = 0; i < 10000; ++i) expected.push_back(gen() % 3 == 0);
+
+	bits_tree actual(expected.begin(), expected.end());
+	check_containers_equality(expected, actual);
+	EXPECT_EQ(actual.count(), static_cast<std::size_t>(std::count(expected.begin(), expected.end(), true)));
+
+	std::size_t ones = 0;
+	for (std::size_t i = 0; i < expected.size(); ++i) {
+		EXPECT_EQ(actual.rank(i), ones);
+		if (expected[i]) {
+			EXPECT_EQ(actual.select(ones), i);
+			++ones;
+		}
+	}
+	EXPECT_EQ(actual.rank(expected.size()), ones);
+	EXPECT_THROW(actual.select(ones), std::out_of_range);
+}
+
+TEST(BitsTree, Access) {
+	constexpr auto defaultSize = 3000;
+	std::vector<bool> expected(defaultSize, 0);
+	bits_tree actual(defaultSize, 0);
+
+	for (std::size_t i = 0; i < defaultSize; i += 3) {
+		expected[i] = 1;
+		actual[i] = 1;
+	}
+	check_containers_equality(expected, actual);
+	EXPECT_EQ(actual.count(), defaultSize / 3);
+	EXPECT_THROW(actual.at(defaultSize), std::out_of_range);
+
+	const bits_tree copy = actual;
+	actual.clear();
+	check_containers_equality(expected, copy);
+	EXPECT_TRUE(actual.empty());
+
+	std::reverse(expected.begin(), expected.end());
+	bits_tree reversed = copy;
+	std::reverse(reversed.begin(), reversed.end());
+	check_containers_equality(expected, reversed);
+
+	expected.resize(100);
+	reversed.resize(100);
+	check_containers_equality(expected, reversed);
+}
+
+TEST(BitsTree, Ranges) {
+	static_assert(std::random_access_iterator<bits_tree::iterator>);
+	static_assert(std::random_access_iterator<bits_tree::const_iterator>);
+	static_assert(std::ranges::random_access_range<bits_tree>);
+
+	std::vector<bool> expected;
+	std::mt19937 gen{ 5 };
+	for (int i = 0; i < 5000; ++i) expected.push_back(gen() % 3 == 0);
+	bits_tree actual(expected.begin(), expected.end());
+
+	EXPECT_EQ(std::ranges::count(actual, true), std::ranges::count(expected, true));
+	EXPECT_TRUE(2 + actual.cbegin() == actual.cbegin() + 2);
+
+	std::ranges::sort(actual, std::greater<>{});
+	std::sort(expected.begin(), expected.end(), std::greater<>{});
+	check_containers_equality(expected, actual);
+}
+
+TEST(CowBitsArray, SnapshotIsolation) {
+	using snapshot_type = cow_bits_array::snapshot_type;
+	static_assert(std::random_access_iterator<snapshot_type::const_iterator>);
+	static_assert(std::ranges::random_access_range<const snapshot_type>);
+
+	constexpr auto defaultSize = 100000;
+	std::vector<bool> expected(defaultSize, 0);
+	cow_bits_array actual(defaultSize, 0);
+
+	for (std::size_t i = 0; i < defaultSize; i += 7) {
+		expected[i] = 1;
+		actual[i] = 1;
+	}
+	EXPECT_TRUE(actual.snapshot().empty());
+
+	actual.publish();
+	const auto before = actual.snapshot();
+	check_containers_equality(expected, before);
+
+	// iterators do not refer to the temporary snapshot
+	const auto it = actual.snapshot().begin();
+	EXPECT_TRUE(*it);
+	EXPECT_FALSE(*(it + 1));
+	EXPECT_TRUE(7 + it == it + 7);
+	EXPECT_EQ(std::ranges::count(before, true), std::ranges::count(expected, true));
+
+	actual[0] = 0;
+	actual.resize(defaultSize / 2);
+	actual.push_back(1);
+	check_containers_equality(expected, before);
+
+	actual.publish();
+	const auto after = actual.snapshot();
+	expected[0] = 0;
+	expected.resize(defaultSize / 2);
+	expected.push_back(1);
+	check_containers_equality(expected, after);
+	EXPECT_EQ(after.count(), static_cast<std::size_t>(std::count(expected.begin(), expected.end(), true)));
+	EXPECT_THROW(after.at(after.size()), std::out_of_range);
+}
+
+TEST(CowBitsArray, ConcurrentReaders) {
+	constexpr auto defaultSize = 200000;
+	constexpr auto versions = 20;
+	cow_bits_array actual(defaultSize, 0);
+	actual.publish();
+
+	std::atomic<bool> done{ false };
+	std::atomic<int> inconsistent{ 0 };
+	std::vector<std::thread> readers;
+	for (int i = 0; i < 4; ++i) {
+		readers.emplace_back([&] {
+			while (!done) {
+				// every published version has all bits equal
+				const auto snap = actual.snapshot();
+				const auto ones = snap.count();
+				if (ones != 0 && ones != snap.size()) ++inconsistent;
+			}
+		});
+	}
+
+	for (int v = 0; v < versions; ++v) {
+		for (std::size_t i = 0; i < defaultSize; ++i) actual[i] = (v % 2 == 0);
+		actual.publish();
+	}
+	done = true;
+	for (auto& reader : readers) reader.join();
+
+	EXPECT_EQ(inconsistent, 0);
+	EXPECT_EQ(actual.snapshot().count(), 0);
+}
+
+TEST(StaticBitsArray, InsertErase) {
+	constexpr auto capacity = 1000;
+	static_assert(std::is_trivially_copyable_v<static_bits_array<capacity>>);
+	static_assert(std::is_same_v<static_bits_array<capacity>::size_type, std::uint16_t>);
+	static_assert(sizeof(static_bits_array<capacity>) <= 136);
+
+	std::vector<bool> expected;
+	static_bits_array<capacity> actual;
+
+	std::mt19937 gen{ 11 };
+	for (int i = 0; i < 5000; ++i) {
+		const bool value = gen() & 1;
+		if (expected.size() + 200 < capacity && gen() % 3 != 0) {
+			const auto index = std::uniform_int_distribution<std::size_t>{ 0, expected.size() }(gen);
+			const auto count = std::uniform_int_distribution<std::size_t>{ 0, 150 }(gen);
+			const auto expectedInserted = expected.insert(expected.cbegin() + index, count, value);
+			const auto actualInserted = actual.insert(actual.cbegin() + index, count, value);
+			EXPECT_EQ(std::distance(expected.begin(), expectedInserted), std::distance(actual.begin(), actualInserted));
+		}
+		else if (!expected.empty()) {
+			const auto first = std::uniform_int_distribution<std::size_t>{ 0, expected.size() - 1 }(gen);
+			const auto last = std::uniform_int_distribution<std::size_t>{ first, std::min(expected.size(), first + 150) }(gen);
+			expected.erase(expected.cbegin() + first, expected.cbegin() + last);
+			actual.erase(actual.cbegin() + first, actual.cbegin() + last);
+		}
+		ASSERT_TRUE(check_equal_sizes(expected, actual));
+		ASSERT_TRUE(check_equality(expected, actual));
+	}
+
+	const auto copy = actual;
+	check_containers_equality(expected, copy);
+
+	expected.resize(capacity, 1);
+	actual.resize(capacity, 1);
+	check_containers_equality(expected, actual);
+	EXPECT_THROW(actual.push_back(0), std::overflow_error);
+
+	std::reverse(expected.begin(), expected.end());
+	std::reverse(actual.begin(), actual.end());
+	check_containers_equality(expected, actual);
+}
+
+TEST(StaticBitsArray, ConstantEvaluation) {
+	constexpr auto arr = [] {
+		static_bits_array<300> result(200, true);
+		result.insert(result.cbegin() + 63, 70, false);
+		result.erase(result.cbegin() + 1, result.cbegin() + 2);
+		return result;
+	}();
+	static_assert(arr.size() == 269);
+	static_assert(arr[0] && arr[61] && !arr[62] && !arr[131] && arr[132] && arr.back());
+}
+
+TEST(StaticBitsArray, Ranges) {
+	using array_type = static_bits_array<500>;
+	static_assert(std::random_access_iterator<array_type::iterator>);
+	static_assert(std::random_access_iterator<array_type::const_iterator>);
+	static_assert(std::ranges::random_access_range<array_type>);
+
+	std::vector<bool> expected;
+	std::mt19937 gen{ 3 };
+	for (int i = 0; i < 400; ++i) expected.push_back(gen() % 3 == 0);
+	array_type actual(expected.begin(), expected.end());
+
+	EXPECT_EQ(std::ranges::count(actual, true), std::ranges::count(expected, true));
+	EXPECT_TRUE(2 + actual.cbegin() == actual.cbegin() + 2);
+
+	std::ranges::sort(actual, std::greater<>{});
+	std::sort(expected.begin(), expected.end(), std::greater<>{});
+	check_containers_equality(expected, actual);
+}
+
+template<class BitsContainer>
+void check_conversions(const std::vector<bool>& expected)
+{
+	std::string text;
+	for (const bool bit : expected) text.push_back(bit ? '1' : '0');
+
+	const auto fromText = from_bits_string<BitsContainer>(text);
+	check_containers_equality(expected, fromText);
+	EXPECT_EQ(to_bits_string(fromText), text);
+
+	const auto fromVector = from_vector_bool<BitsContainer>(expected);
+	check_containers_equality(expected, fromVector);
+	EXPECT_EQ(to_vector_bool(fromVector), expected);
+
+	for (const auto order : { bit_order::msb_first, bit_order::lsb_first }) {
+		std::vector<std::uint8_t> bytes((expected.size() + 7) / 8);
+		for (std::size_t i = 0; i < expected.size(); ++i) {
+			const auto shift = (order == bit_order::msb_first) ? 7 - i % 8 : i % 8;
+			bytes[i / 8] |= static_cast<std::uint8_t>(expected[i] << shift);
+		}
+
+		const auto fromBytes = from_bytes<BitsContainer>(bytes.data(), expected.size(), order);
+		check_containers_equality(expected, fromBytes);
+		EXPECT_EQ(to_bytes(fromBytes, order), bytes);
+	}
+}
+
+TEST(Conversions, AllContainers) {
+	std::mt19937 gen{ 5 };
+	const auto random_bits = [&](std::size_t count) {
+		std::vector<bool> result(count);
+		for (std::size_t i = 0; i < count; ++i) result[i] = gen() & 1;
+		return result;
+	};
+
+	check_conversions<bits_array<std::uint32_t>>(random_bits(0));
+	check_conversions<bits_array<std::uint32_t>>(random_bits(27));
+	check_conversions<bits_array<std::uint64_t>>(random_bits(64));
+	check_conversions<static_bits_array<1000>>(random_bits(1000));
+	check_conversions<static_bits_array<1000>>(random_bits(333));
+	check_conversions<bits_tree>(random_bits(100003));
+
+	// tree built in bulk stays balanced under following updates
+	auto expected = random_bits(50000);
+	auto tree = from_vector_bool<bits_tree>(expected);
+	for (int i = 0; i < 30000; ++i) {
+		const auto index = std::uniform_int_distribution<std::size_t>{ 0, expected.size() - 1 }(gen);
+		if (i % 3 == 0) {
+			expected.insert(expected.cbegin() + index, true);
+			tree.insert(tree.cbegin() + index, true);
+		}
+		else {
+			expected.erase(expected.cbegin() + index);
+			tree.erase(tree.cbegin() + index);
+		}
+	}
+	check_containers_equality(expected, tree);
+	EXPECT_EQ(tree.rank(tree.size()), static_cast<std::size_t>(std::count(expected.begin(), expected.end(), true)));
+
+	EXPECT_THROW(from_bits_string<bits_tree>(std::string(100, '1') + "2"), std::invalid_argument);
+	EXPECT_THROW(from_bits_string<bits_tree>(std::string(63, '1') + " " + std::string(64, '0')), std::invalid_argument);
+	EXPECT_THROW(from_bits_string<bits_array<std::uint8_t>>("110011001"), std::overflow_error);
+}
+
+TEST(Conversions, Bitset) {
+	const std::bitset<100> expected{ "1001110001111010010100101" };
+	const auto actual = from_bitset<static_bits_array<128>>(expected);
+	EXPECT_EQ(actual.size(), expected.size());
+	for (std::size_t i = 0; i < expected.size(); ++i) EXPECT_EQ(actual[i], expected[i]);
+	EXPECT_EQ(to_bitset<100>(actual), expected);
+	EXPECT_THROW(to_bitset<64>(actual), std::overflow_error);
+
+#ifdef __cpp_lib_format
+	EXPECT_EQ(std::format("{}", "0110"_bits), "0110");
+#endif
+}
+
+TEST(Stats, DisabledByDefault) {
+	static_assert(!bits_stats_enabled);
+	reset_thread_bits_stats();
+
+	bits_array<std::uint32_t> actual(10, true);
+	actual.insert(actual.cbegin() + 4, 3, false);
+	actual.erase(actual.cbegin());
+	actual[3] = true;
+	EXPECT_THROW(actual.at(20), std::out_of_range);
+
+	const auto& stats = thread_bits_stats();
+	EXPECT_EQ(stats.insert.calls, 0);
+	EXPECT_EQ(stats.erase.calls, 0);
+	EXPECT_EQ(stats.proxy_write.calls, 0);
+	EXPECT_EQ(stats.failed_check.calls, 0);
+}